@@ -0,0 +1,106 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// ===============================================================================================================
+// Single-producer / single-consumer ring buffer that carries audio from processBlock to the analysis thread.
+// The audio thread only ever memcpy's whole blocks in, the analysis thread drains it at its own pace.
+// Nothing in push() allocates, locks or waits: if the reader falls behind the block is dropped and counted.
+//
+// Optional reference channels follow the audio channels in the same slots. They carry the stimulus as it was
+// before the hosted plugins, so input and output always arrive sample aligned, and are dropped together.
+class AnalysisFifo
+{
+public:
+    AnalysisFifo() = default;
+
+    // Call while neither side is running (prepareToPlay)
+    void prepare(int numChannels, int capacityInSamples, int newNumReferenceChannels = 0)
+    {
+        numAudioChannels = numChannels;
+        numReferenceChannels = newNumReferenceChannels;
+        storage.setSize(numChannels + numReferenceChannels, capacityInSamples, false, true, false);
+        fifo.setTotalSize(capacityInSamples);
+        fifo.reset();
+        numDropped.store(0);
+    }
+
+    void reset() noexcept
+    {
+        fifo.reset();
+    }
+
+    // =============================
+    // Audio thread
+    // =============================
+    // reference, if given, fills the reference channels. Without it they are written as silence.
+    void push(const juce::AudioBuffer<float>& source, int numSamples,
+              const juce::AudioBuffer<float>* reference = nullptr) noexcept
+    {
+        if (fifo.getFreeSpace() < numSamples)
+        {
+            numDropped.fetch_add(numSamples, std::memory_order_relaxed);
+            return;
+        }
+
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+
+        for (int ch = 0; ch < storage.getNumChannels(); ++ch)
+        {
+            auto* from = ch < numAudioChannels ? &source : reference;
+            auto sourceChannel = ch < numAudioChannels ? ch : ch - numAudioChannels;
+
+            // Missing source channels are written as silence so every channel stays sample aligned
+            if (from != nullptr && sourceChannel < from->getNumChannels())
+            {
+                auto* src = from->getReadPointer(sourceChannel);
+                if (size1 > 0) std::memcpy(storage.getWritePointer(ch, start1), src, sizeof(float) * (size_t)size1);
+                if (size2 > 0) std::memcpy(storage.getWritePointer(ch, start2), src + size1, sizeof(float) * (size_t)size2);
+            }
+            else
+            {
+                if (size1 > 0) juce::FloatVectorOperations::clear(storage.getWritePointer(ch, start1), size1);
+                if (size2 > 0) juce::FloatVectorOperations::clear(storage.getWritePointer(ch, start2), size2);
+            }
+        }
+
+        fifo.finishedWrite(size1 + size2);
+    }
+
+    // =============================
+    // Analysis thread
+    // =============================
+    int getNumReady() const noexcept { return fifo.getNumReady(); }
+    int getNumChannels() const noexcept { return numAudioChannels; }
+    int getNumReferenceChannels() const noexcept { return numReferenceChannels; }
+    int getNumDropped() const noexcept { return numDropped.load(std::memory_order_relaxed); }
+
+    // Copies numSamples of the audio channels, then the reference channels, into dest starting at
+    // destStartSample. Returns how many were actually read.
+    int pop(juce::AudioBuffer<float>& dest, int destStartSample, int numSamples) noexcept
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(numSamples, start1, size1, start2, size2);
+
+        auto numChannels = juce::jmin(dest.getNumChannels(), storage.getNumChannels());
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            auto* dst = dest.getWritePointer(ch, destStartSample);
+            if (size1 > 0) std::memcpy(dst, storage.getReadPointer(ch, start1), sizeof(float) * (size_t)size1);
+            if (size2 > 0) std::memcpy(dst + size1, storage.getReadPointer(ch, start2), sizeof(float) * (size_t)size2);
+        }
+
+        fifo.finishedRead(size1 + size2);
+        return size1 + size2;
+    }
+
+private:
+    juce::AbstractFifo fifo{ 1 };
+    juce::AudioBuffer<float> storage;       // audio channels, then reference channels
+    int numAudioChannels = 0;
+    int numReferenceChannels = 0;
+    std::atomic<int> numDropped{ 0 };
+
+    JUCE_DECLARE_NON_COPYABLE(AnalysisFifo)
+};
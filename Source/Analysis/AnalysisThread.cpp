@@ -0,0 +1,396 @@
+#include "AnalysisThread.h"
+#include "../PluginProcessor.h"
+
+namespace
+{
+    template <typename Array>
+    void copyBands(const ScratchArray<float>& from, Array& to) noexcept
+    {
+        std::copy_n(from.begin(), juce::jmin((size_t)from.size, to.size()), to.begin());
+    }
+}
+
+AnalysisThread::AnalysisThread(ChainBuilderAudioProcessor& proc, AnalysisFifo& fifoRef)
+    : juce::Thread("Probe Analysis"),
+      audioProcessor(proc),
+      fifo(fifoRef)
+{
+    registerMetrics();
+
+    // Integrated loudness and loudness range cover the whole programme, so they run whoever is reading:
+    // a reader coming back (the editor reopening, the prompt sidebar opening) must not restart them.
+    // Only resetLoudness() does.
+    registry.subscribe(MetricConsumer::programme, { MetricId::loudness });
+}
+
+AnalysisThread::~AnalysisThread()
+{
+    stopThread(1000);
+}
+
+void AnalysisThread::prepare(double newSampleRate, int newNumChannels)
+{
+    jassert(!isThreadRunning());
+
+    sampleRate = newSampleRate;
+    numChannels = newNumChannels;
+    plans.prepare(sampleRate);
+    current = {};
+
+    // Independent of the STFT, they see every sample once
+    loudness.prepare(sampleRate, numChannels);
+    modulation.prepare(sampleRate);
+    decay.prepare(sampleRate, numChannels, StimulusGenerator::impulseSeconds);
+    sweep.prepare(sampleRate);
+
+    currentOrder = -1; // rebuild everything at the new rate
+    configure(requestedOrder.load(), (FftPlan::Window)requestedWindow.load());
+}
+
+void AnalysisThread::configure(int order, FftPlan::Window window)
+{
+    auto& plan = plans.get(order, window);
+    auto fftSize = plan.getSize();
+    auto sizeChanged = order != currentOrder;
+    currentOrder = order;
+    currentWindow = window;
+
+    if (sizeChanged)
+    {
+        // Filterbanks, scratch memory, transfer averages and the dynamics history only depend on the size,
+        // so a window switch leaves them (and what they have accumulated) alone
+        stft.prepare(numChannels, plan, numChannels);
+        context.prepare(sampleRate, fftSize, numChannels);
+
+        // Harmonics need the Blackman-Harris sidelobes whatever the display window is
+        distortion.prepare(plans.get(order, FftPlan::Window::blackmanHarris));
+        transfer.prepare(sampleRate, fftSize, context.getThirdOctaveBands());
+
+        // Sized for the smallest hop setOverlap() allows
+        dynamics.prepare(sampleRate * 8.0 / fftSize);
+    }
+    else
+    {
+        stft.setWindow(plan);
+    }
+
+    spectra.prepare(numChannels, plan);
+    referenceSpectra.prepare(numChannels, plan);
+    midSpectrum.prepare(plan);
+    pitch.prepare(plan);
+    smpteImd.prepare(IntermodulationMeter::Standard::smpte, sampleRate, fftSize, plan.getMainLobeBins());
+    ccifImd.prepare(IntermodulationMeter::Standard::ccif, sampleRate, fftSize, plan.getMainLobeBins());
+    bandMeanSquareScale = plan.getMeanSquareScale();
+}
+
+void AnalysisThread::run()
+{
+    while (!threadShouldExit())
+    {
+        if (fifo.getNumReady() == 0)
+        {
+            // Nothing to do yet, a frame only completes every hop anyway
+            wait(2);
+            continue;
+        }
+
+        if (loudnessResetPending.exchange(false))
+            loudness.reset();
+
+        auto order = requestedOrder.load();
+        auto window = (FftPlan::Window)requestedWindow.load();
+        if (order != currentOrder || window != currentWindow)
+            configure(order, window);
+
+        registry.update();
+
+        auto numPulled = stft.pull(fifo);
+        registry.computeStream({ stft.viewLatest(numPulled), stft.viewLatestReference(numPulled), numPulled });
+        current.samplePosition += numPulled;
+
+        if (stft.isFrameReady())
+        {
+            // Consumed either way, so the hop keeps its pace while nothing reads the frame metrics
+            auto& frame = stft.takeFrame();                              // newest fftSize samples, no copy
+            if (registry.hasFrameMetrics())
+                analyseFrame(frame);
+        }
+
+        // One copy per pull, never a lock: readers swap in whole snapshots at their own pace
+        current.timestamp = juce::Time::getMillisecondCounterHiRes();
+        snapshots.publish(current);
+    }
+}
+
+void AnalysisThread::analyseFrame(const juce::AudioBuffer<float>& frame)
+{
+    context.beginFrame();
+    registry.computeFrame({ frame, stft.getReferenceFrame(), frame.getNumSamples() });
+    ++current.frameNumber;
+}
+
+void AnalysisThread::registerMetrics()
+{
+    using Id = MetricId;
+    using Domain = MetricDomain;
+    auto add = [this](Id id, const char* name, Domain domain, MetricSet dependencies,
+                      MetricRegistry::Compute compute, std::function<void()> restart = nullptr)
+    {
+        registry.add({ id, name, domain, dependencies, std::move(compute), std::move(restart) });
+    };
+
+    // Shared intermediates
+    add(Id::timeStats, "Time domain statistics", Domain::time, {},
+        [this](const MetricInput& in) { stats = Metrics::computeTimeDomainStats(in.audio); });
+    add(Id::spectra, "Channel spectra", Domain::frequency, {},
+        [this](const MetricInput& in) { spectra.compute(in.audio, stft.getWindow()); });    // every channel at once
+    add(Id::midSpectrum, "Mid spectrum", Domain::frequency, { Id::spectra }, [this](const MetricInput&)
+    {
+        // Spectral metrics describe the mid (mono sum) spectrum, so no channel is ignored
+        auto mid = spectra.getMidIndex();
+        midSpectrum.compute(spectra.getMagnitude(mid), spectra.getPower(mid));
+    });
+
+    // Every sample
+    add(Id::loudness, "Loudness", Domain::stream, {}, [this](const MetricInput& in)
+    {
+        loudness.process(in.audio, in.numSamples);
+        current.lufs = loudness.getIntegrated();
+        current.lufs_momentary = loudness.getMomentary();
+        current.lufs_short_term = loudness.getShortTerm();
+        current.loudness_range = loudness.getLoudnessRange();
+    }, [this] { loudness.reset(); });
+    add(Id::modulation, "Modulation", Domain::stream, {}, [this](const MetricInput& in)
+    {
+        modulation.process(in.audio, in.numSamples);
+        current.modulation_depth = modulation.getDepth();
+        current.modulation_rate = modulation.getRate();
+    }, [this] { modulation.reset(); });
+    add(Id::decay, "Decay time", Domain::stream, {},
+        [this](const MetricInput& in) { measureDecay(in.audio, in.numSamples); }, [this] { decay.reset(); });
+    add(Id::sweep, "Sweep response", Domain::stream, {},
+        [this](const MetricInput& in) { measureSweep(in.audio, in.reference, in.numSamples); }, [this] { sweep.reset(); });
+
+    // Time domain, all read off the one fused pass
+    add(Id::rms, "RMS", Domain::time, { Id::timeStats },
+        [this](const MetricInput&) { current.rms = stats.getRMS(); });
+    add(Id::peak, "Peak", Domain::time, { Id::timeStats },
+        [this](const MetricInput&) { current.peak = stats.peak; });
+    add(Id::crestFactor, "Crest factor", Domain::time, { Id::timeStats },
+        [this](const MetricInput&) { current.crest_factor = stats.getCrestFactor(); });
+    add(Id::transientSharpness, "Transient sharpness", Domain::time, { Id::timeStats },
+        [this](const MetricInput&) { current.transient_sharpness = stats.maxDelta; });
+    add(Id::stereoCorrelation, "Stereo correlation", Domain::time, { Id::timeStats },
+        [this](const MetricInput&) { current.stereo_correlation = stats.getStereoCorrelation(); });
+
+    // Frequency domain
+    add(Id::spectralCentroid, "Spectral centroid", Domain::frequency, { Id::midSpectrum },
+        [this](const MetricInput&) { current.spectral_centroid = Metrics::computeSpectralCentroid(midSpectrum); });
+    add(Id::spectralRolloff, "Spectral rolloff", Domain::frequency, { Id::midSpectrum },
+        [this](const MetricInput&) { current.spectral_rolloff = Metrics::computeSpectralRolloff(midSpectrum, 0.95f); });
+    add(Id::spectralFlatness, "Spectral flatness", Domain::frequency, { Id::midSpectrum },
+        [this](const MetricInput&) { current.spectral_flatness = Metrics::computeSpectralFlatness(midSpectrum); });
+    add(Id::resonanceScore, "Resonance score", Domain::frequency, { Id::midSpectrum },
+        [this](const MetricInput&) { current.resonance_score = Metrics::computeResonanceScore(midSpectrum); });
+    add(Id::pitch, "Pitch and HNR", Domain::frequency, { Id::midSpectrum }, [this](const MetricInput&)
+    {
+        pitch.process(midSpectrum);
+        current.harmonic_to_noise = pitch.getHarmonicToNoise();
+        current.fundamental_frequency = pitch.getFundamental();
+        current.pitch_confidence = pitch.getConfidence();
+    });
+
+    // Band vectors: one sparse pass over the power spectrum per filterbank
+    add(Id::bandEnergy, "Band energy", Domain::frequency, { Id::midSpectrum },
+        [this](const MetricInput&) { current.band_energy = Metrics::computeBandEnergy(midSpectrum); });
+    add(Id::tonalBalance, "Tonal balance", Domain::frequency, { Id::midSpectrum }, [this](const MetricInput&)
+    {
+        copyBands(Metrics::computeTonalBalance(midSpectrum, context), current.tonal_balance);
+    });
+    add(Id::barkBands, "Bark bands", Domain::frequency, { Id::midSpectrum }, [this](const MetricInput&)
+    {
+        copyBands(Metrics::computeBandPowers(midSpectrum, context.getBarkBands(), context), current.bark_bands);
+    });
+    add(Id::melBands, "Mel bands", Domain::frequency, { Id::midSpectrum }, [this](const MetricInput&)
+    {
+        copyBands(Metrics::computeBandPowers(midSpectrum, context.getMelBands(), context), current.mel_bands);
+    });
+    add(Id::spectralDynamics, "Spectral dynamics", Domain::frequency, { Id::midSpectrum },
+        [this](const MetricInput&) { trackSpectralDynamics(); }, [this] { dynamics.reset(); });
+
+    // Stimulus measurements, each only while its stimulus is playing
+    add(Id::distortion, "Distortion", Domain::frequency, {},
+        [this](const MetricInput& in) { measureDistortion(in.audio); }, [this] { distortion.reset(); });
+    add(Id::intermodulation, "Intermodulation", Domain::frequency, { Id::midSpectrum },
+        [this](const MetricInput&) { measureIntermodulation(); });
+    add(Id::transferFunction, "Transfer function", Domain::frequency, { Id::spectra },
+        [this](const MetricInput& in) { measureTransferFunction(in.reference); }, [this] { transfer.reset(); });
+}
+
+void AnalysisThread::measureDistortion(const juce::AudioBuffer<float>& frame)
+{
+    // Harmonics only mean something while we know the input is a single pure tone
+    if (audioProcessor.stimulus.getType() != StimulusGenerator::Type::sine)
+    {
+        if (distortion.hasReading())
+        {
+            distortion.reset();
+            current.thd = current.thd_plus_noise = 0.0f;
+            current.harmonic_levels.fill(0.0f);
+        }
+        return;
+    }
+
+    // Unresolved (a low tone or a small FFT) reads as no reading, not as a clean 0 %
+    distortion.process(frame);
+    if (!distortion.hasReading())
+    {
+        current.thd = current.thd_plus_noise = 0.0f;
+        current.harmonic_levels.fill(0.0f);
+        return;
+    }
+
+    current.thd = 100.0f * distortion.getTHD();
+    current.thd_plus_noise = 100.0f * distortion.getTHDPlusNoise();
+    for (int i = 0; i < (int)current.harmonic_levels.size(); ++i)
+        current.harmonic_levels[(size_t)i] = distortion.getHarmonicLevel(i + 2);
+}
+
+void AnalysisThread::measureIntermodulation()
+{
+    auto type = audioProcessor.stimulus.getType();
+    auto* meter = type == StimulusGenerator::Type::smpteTwoTone ? &smpteImd
+                : type == StimulusGenerator::Type::ccifTwoTone ? &ccifImd
+                : nullptr;
+
+    // Too short an FFT can't resolve the products, better no reading than the tones' leakage
+    if (meter == nullptr || !meter->hasReading())
+    {
+        current.imd = 0.0f;
+        current.imd_num_products = 0;
+        return;
+    }
+
+    // A few bin lookups in the spectrum the other metrics already used
+    meter->process(midSpectrum);
+
+    current.imd = 100.0f * meter->getIMD();
+    current.imd_num_products = meter->getNumProducts();
+    for (int i = 0; i < meter->getNumProducts(); ++i)
+    {
+        current.imd_product_frequencies[(size_t)i] = meter->getProductFrequency(i);
+        current.imd_product_levels[(size_t)i] = meter->getProductLevel(i);
+    }
+}
+
+void AnalysisThread::measureTransferFunction(const juce::AudioBuffer<float>& reference)
+{
+    // H(f) needs energy in every bin it reports, so only the broadband stimuli qualify
+    auto type = audioProcessor.stimulus.getType();
+    if (type != StimulusGenerator::Type::whiteNoise && type != StimulusGenerator::Type::pinkNoise
+        && type != StimulusGenerator::Type::logSweep && type != StimulusGenerator::Type::multitone)
+    {
+        if (transfer.hasReading())
+        {
+            transfer.reset();
+            current.frequency_response.fill(0.0f);
+            current.phase_response.fill(0.0f);
+            current.group_delay.fill(0.0f);
+            current.coherence.fill(0.0f);
+        }
+        return;
+    }
+
+    referenceSpectra.compute(reference, stft.getWindow());
+
+    // Mid against mid, the same view of the output the spectral metrics use
+    auto in = referenceSpectra.getMidIndex();
+    auto out = spectra.getMidIndex();
+    transfer.process(referenceSpectra.getReal(in), referenceSpectra.getImag(in), spectra.getReal(out), spectra.getImag(out));
+
+    for (int b = 0; b < juce::jmin(transfer.getNumBands(), (int)current.frequency_response.size()); ++b)
+    {
+        auto index = (size_t)b;
+        current.frequency_response[index] = transfer.getBandGain(b);
+        current.phase_response[index] = transfer.getBandPhase(b);
+        current.group_delay[index] = 1000.0f * transfer.getBandGroupDelay(b);
+        current.coherence[index] = transfer.getBandCoherence(b);
+    }
+}
+
+void AnalysisThread::trackSpectralDynamics()
+{
+    auto& bands = context.getFilterbank((Filterbank::Scale)dynamicsScale.load());
+    dynamics.configure(bands.getNumBands(), sampleRate / stft.getHopSize(), dynamicsHistorySeconds.load());
+
+    auto levels = Metrics::computeSpectralDynamics(midSpectrum, bands, bandMeanSquareScale, context);
+    if (levels.size != dynamics.getNumBands())
+        return;
+
+    dynamics.push(levels.data);
+
+    current.num_dynamics_bands = dynamics.getNumBands();
+    for (int b = 0; b < dynamics.getNumBands(); ++b)
+    {
+        current.band_level_range[(size_t)b] = dynamics.getMax(b) - dynamics.getMin(b);
+        current.band_level_deviation[(size_t)b] = std::sqrt(dynamics.getVariance(b));
+    }
+}
+
+void AnalysisThread::measureDecay(const juce::AudioBuffer<float>& latest, int numSamples)
+{
+    // A decay time is only defined for a known excitation
+    if (audioProcessor.stimulus.getType() != StimulusGenerator::Type::impulseTrain)
+    {
+        if (decay.hasReading())
+        {
+            decay.reset();
+            current.decay_time = current.early_decay_time = 0.0f;
+            current.octave_decay_times.fill(0.0f);
+        }
+        return;
+    }
+
+    auto numCaptures = decay.getNumCaptures();
+    decay.process(latest, numSamples);
+    if (decay.getNumCaptures() == numCaptures)
+        return;
+
+    current.decay_time = decay.getBroadband().getRT60();
+    current.early_decay_time = decay.getBroadband().edt;
+    for (int band = 0; band < DecayMeter::numOctaveBands; ++band)
+        current.octave_decay_times[(size_t)band] = decay.getOctaveBand(band).getRT60();
+}
+
+void AnalysisThread::measureSweep(const juce::AudioBuffer<float>& latest, const juce::AudioBuffer<float>& reference, int numSamples)
+{
+    if (audioProcessor.stimulus.getType() != StimulusGenerator::Type::logSweep)
+    {
+        // Also when it never got to a reading, a restarted sweep must not see the old capture
+        if (sweep.isRunning())
+        {
+            sweep.reset();
+            current.sweep_response.fill(0.0f);
+            current.sweep_harmonic_levels.fill(0.0f);
+            current.sweep_thd = current.sweep_latency = 0.0f;
+        }
+        return;
+    }
+
+    auto numCaptures = sweep.getNumCaptures();
+    sweep.process(latest, reference, numSamples);
+    if (sweep.getNumCaptures() == numCaptures)
+        return;
+
+    for (int b = 0; b < juce::jmin(sweep.getNumBands(), (int)current.sweep_response.size()); ++b)
+        current.sweep_response[(size_t)b] = sweep.getBandGain(b);
+
+    for (int h = 2; h <= SweepMeter::maxHarmonic; ++h)
+        current.sweep_harmonic_levels[(size_t)h - 2] = sweep.getHarmonicLevel(h);
+
+    current.sweep_thd = 100.0f * sweep.getTHD();
+
+    // The reference was already delayed by the reported latency, the sweep measures what is left on top
+    auto totalLatency = audioProcessor.rack.getTotalLatency() + sweep.getLatency();
+    current.sweep_latency = (float)(1000.0 * totalLatency / sampleRate);
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "AnalysisFifo.h"
+#include "SlidingStft.h"
+#include "ChannelSpectra.h"
+#include "MetricRegistry.h"
+#include "MetricSnapshot.h"
+#include "TripleBuffer.h"
+#include "../Metrics/FftPlan.h"
+#include "../Metrics/Metrics.h"
+#include "../Metrics/LoudnessMeter.h"
+#include "../Metrics/DistortionMeter.h"
+#include "../Metrics/IntermodulationMeter.h"
+#include "../Metrics/SpectralDynamics.h"
+#include "../Metrics/ModulationMeter.h"
+#include "../Metrics/DecayMeter.h"
+#include "../Metrics/PitchMeter.h"
+#include "../Metrics/TransferFunctionMeter.h"
+#include "../Metrics/SweepMeter.h"
+
+class ChainBuilderAudioProcessor; // forward declaration
+
+// ===============================================================================================================
+// Drains the AnalysisFifo into an overlapping STFT and runs every metric on each frame.
+// All windowing, FFT and Metrics:: work happens here so the audio callback only pays for a memcpy.
+// Only metrics some consumer has subscribed to run, see MetricRegistry; with nothing else subscribed the
+// thread keeps the fifo drained and integrates loudness, which always runs. Results are published as whole
+// MetricSnapshots after every pass.
+// FFT size and window can change while running: the thread notices between frames and re-prepares the
+// frame-based metrics from a cached FftPlan, so the audio thread never sees the switch.
+class AnalysisThread : public juce::Thread
+{
+public:
+    AnalysisThread(ChainBuilderAudioProcessor& proc, AnalysisFifo& fifoRef);
+    ~AnalysisThread() override;
+
+    // Call while the thread is stopped
+    void prepare(double newSampleRate, int numChannels);
+
+    // FFT size as 2 ^ order (FftPlan::minOrder .. maxOrder) and analysis window. Any thread, applied before
+    // the next frame; the STFT history and the frame-based averages restart.
+    void setFftOrder(int newOrder) { requestedOrder.store(juce::jlimit((int)FftPlan::minOrder, (int)FftPlan::maxOrder, newOrder)); }
+    void setWindow(FftPlan::Window newWindow) { requestedWindow.store((int)newWindow); }
+    int getFftOrder() const noexcept { return requestedOrder.load(); }
+    FftPlan::Window getWindow() const noexcept { return (FftPlan::Window)requestedWindow.load(); }
+
+    // Frames per fftSize: 2, 4 or 8 (50 / 75 / 87.5 % overlap). Any thread.
+    void setOverlap(int newOverlap) { stft.setOverlap(newOverlap); }
+
+    // The latest published metrics, all from the same pass. Message thread only: it is the one reader, and
+    // the reference stays valid and unchanged until its next call.
+    const MetricSnapshot& readMetrics() noexcept { return snapshots.read(); }
+
+    // Replaces what consumer reads, an empty set unsubscribes it. Any thread, applied before the next pull.
+    void subscribe(MetricConsumer consumer, MetricSet metrics) { registry.subscribe(consumer, metrics); }
+
+    // Restarts integrated loudness and loudness range, e.g. when the programme changes. Any thread.
+    void resetLoudness() { loudnessResetPending.store(true); }
+
+    // Band set and length of the spectral dynamics history. Any thread, a change restarts the history.
+    void setDynamicsBands(Filterbank::Scale scale) { dynamicsScale.store((int)scale); }
+    void setDynamicsHistory(double seconds) { dynamicsHistorySeconds.store(seconds); }
+
+    void run() override;
+
+private:
+    // Re-prepares what depends on the window, and on the FFT size too if the order changed. Analysis thread,
+    // or while it is stopped.
+    void configure(int order, FftPlan::Window window);
+    void registerMetrics();
+    void analyseFrame(const juce::AudioBuffer<float>& frame);
+    void measureDistortion(const juce::AudioBuffer<float>& frame);
+    void measureIntermodulation();
+    void measureTransferFunction(const juce::AudioBuffer<float>& reference);
+    void trackSpectralDynamics();
+    void measureDecay(const juce::AudioBuffer<float>& latest, int numSamples);
+    void measureSweep(const juce::AudioBuffer<float>& latest, const juce::AudioBuffer<float>& reference, int numSamples);
+
+    ChainBuilderAudioProcessor& audioProcessor;
+    AnalysisFifo& fifo;
+
+    double sampleRate = 44100.0;
+    int numChannels = 0;
+
+    MetricRegistry registry;                   // what runs, and in which order
+    Metrics::TimeDomainStats stats;            // this frame's, shared by the time-domain metrics
+    MetricSnapshot current;                    // what the metrics write into, copied out whole by publish
+    TripleBuffer<MetricSnapshot> snapshots;
+
+    FftPlanCache plans;                        // every size / window combination used so far
+    std::atomic<int> requestedOrder{ (int)FftPlan::defaultOrder };
+    std::atomic<int> requestedWindow{ (int)FftPlan::Window::hann };
+    int currentOrder = 0;
+    FftPlan::Window currentWindow = FftPlan::Window::hann;
+
+    SlidingStft stft;                          // history, framing and window
+    ChannelSpectra spectra;                    // every channel plus mid and side, batched FFTs
+    SpectrumFrame midSpectrum;                 // what the spectral metrics read
+    PitchMeter pitch;                          // f0 and HNR from midSpectrum's power
+    AnalysisContext context;                   // sample rate and scratch memory for Metrics::, rewound every frame
+    LoudnessMeter loudness;                    // sees every sample once, independent of the STFT hop
+    ModulationMeter modulation;                // likewise, at a ~200 Hz envelope rate
+    DecayMeter decay;                          // likewise, only while the impulse train is playing
+    SweepMeter sweep;                          // likewise, only while the log sweep is playing
+    std::atomic<bool> loudnessResetPending{ false };
+    DistortionMeter distortion;                // only while the sine stimulus is playing
+    IntermodulationMeter smpteImd, ccifImd;    // only while the matching two-tone stimulus is playing
+    ChannelSpectra referenceSpectra;           // the pre-chain stimulus, same window and FFT as spectra
+    TransferFunctionMeter transfer;            // only while a broadband stimulus is playing
+
+    SpectralDynamics dynamics;                 // band level history
+    float bandMeanSquareScale = 0.0f;          // spectral power to mean square for the STFT window
+    std::atomic<int> dynamicsScale{ (int)Filterbank::Scale::thirdOctave };
+    std::atomic<double> dynamicsHistorySeconds{ SpectralDynamics::defaultHistorySeconds };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AnalysisThread)
+};
@@ -0,0 +1,108 @@
+#include "ChannelSpectra.h"
+
+void ChannelSpectra::prepare(int newNumChannels, const FftPlan& plan)
+{
+    numChannels = juce::jmax(1, newNumChannels);
+    numSpectra = numChannels >= 2 ? numChannels + 2 : 1;
+
+    fftSize = plan.getSize();
+    fft = &plan.getFft();
+    stride = (getNumBins() + 7) & ~7;
+
+    fftIn.allocate((size_t)fftSize, true);
+    fftOut.allocate((size_t)fftSize, true);
+
+    auto total = (size_t)numSpectra * (size_t)stride;
+    real.allocate(total, true);
+    imag.allocate(total, true);
+    power.allocate(total, true);
+    magnitude.allocate(total, true);
+}
+
+void ChannelSpectra::compute(const juce::AudioBuffer<float>& frame, const float* window) noexcept
+{
+    jassert(frame.getNumSamples() >= fftSize);
+
+    auto numFrameChannels = juce::jmin(numChannels, frame.getNumChannels());
+    for (int ch = 0; ch < numFrameChannels; ch += 2)
+    {
+        auto hasPartner = ch + 1 < numFrameChannels;
+        transformPair(frame.getReadPointer(ch), hasPartner ? frame.getReadPointer(ch + 1) : nullptr,
+                      window, ch, hasPartner ? ch + 1 : -1);
+    }
+
+    auto numBins = getNumBins();
+
+    // Mid = (L + R) / 2, side = (L - R) / 2, straight from the L and R spectra
+    if (numChannels >= 2)
+    {
+        auto* lr = realOf(0);
+        auto* li = imagOf(0);
+        auto* rr = realOf(1);
+        auto* ri = imagOf(1);
+        auto* mr = realOf(getMidIndex());
+        auto* mi = imagOf(getMidIndex());
+        auto* sr = realOf(getSideIndex());
+        auto* si = imagOf(getSideIndex());
+
+        for (int k = 0; k < numBins; ++k)
+        {
+            mr[k] = 0.5f * (lr[k] + rr[k]);
+            mi[k] = 0.5f * (li[k] + ri[k]);
+            sr[k] = 0.5f * (lr[k] - rr[k]);
+            si[k] = 0.5f * (li[k] - ri[k]);
+        }
+    }
+
+    // One flat, vectorisable pass over every spectrum: power, then magnitude from it
+    auto total = numSpectra * stride;
+    auto* re = real.get();
+    auto* im = imag.get();
+    auto* pw = power.get();
+    auto* mag = magnitude.get();
+    for (int i = 0; i < total; ++i)
+    {
+        pw[i] = re[i] * re[i] + im[i] * im[i];
+        mag[i] = std::sqrt(pw[i]);
+    }
+}
+
+void ChannelSpectra::transformPair(const float* a, const float* b, const float* window, int indexA, int indexB) noexcept
+{
+    auto* in = fftIn.get();
+    if (b != nullptr)
+    {
+        for (int n = 0; n < fftSize; ++n)
+            in[n] = { a[n] * window[n], b[n] * window[n] };
+    }
+    else
+    {
+        for (int n = 0; n < fftSize; ++n)
+            in[n] = { a[n] * window[n], 0.0f };
+    }
+
+    fft->perform(fftIn.get(), fftOut.get(), false);
+
+    // Z = A + iB with a and b real, so A[k] = (Z[k] + conj(Z[N - k])) / 2 and B[k] = (Z[k] - conj(Z[N - k])) / 2i
+    auto* out = fftOut.get();
+    auto* ar = realOf(indexA);
+    auto* ai = imagOf(indexA);
+    auto* br = indexB >= 0 ? realOf(indexB) : nullptr;
+    auto* bi = indexB >= 0 ? imagOf(indexB) : nullptr;
+    auto mask = fftSize - 1;
+
+    for (int k = 0; k < getNumBins(); ++k)
+    {
+        auto z = out[k];
+        auto zc = std::conj(out[(fftSize - k) & mask]);
+
+        ar[k] = 0.5f * (z.real() + zc.real());
+        ai[k] = 0.5f * (z.imag() + zc.imag());
+
+        if (br != nullptr)
+        {
+            br[k] = 0.5f * (z.imag() - zc.imag());
+            bi[k] = -0.5f * (z.real() - zc.real());
+        }
+    }
+}
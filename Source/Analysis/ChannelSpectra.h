@@ -0,0 +1,54 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "../Metrics/FftPlan.h"
+
+// ===============================================================================================================
+// Spectra of every channel of an analysis frame, plus mid and side derived from the first two channels.
+// Channels are transformed two at a time: one is packed into the real part and one into the imaginary part
+// of a single complex FFT, then separated using the conjugate symmetry of real signals. Stereo costs one
+// FFT, 5.1 three. Mid and side fall out of the same pair by linearity, so they cost no FFT at all.
+//
+// Results are planar: one contiguous block of real parts, imaginary parts, power and magnitude per spectrum,
+// bins 0 .. fftSize / 2, each spectrum padded to a multiple of 8 floats.
+class ChannelSpectra
+{
+public:
+    ChannelSpectra() = default;
+
+    // Allocates. The FFT is the plan's, which must outlive this. Analysis thread or while it is stopped.
+    void prepare(int newNumChannels, const FftPlan& plan);
+
+    // Windows every channel of frame (fftSize samples) and transforms them
+    void compute(const juce::AudioBuffer<float>& frame, const float* window) noexcept;
+
+    int getNumChannels() const noexcept { return numChannels; }
+    int getNumBins() const noexcept { return fftSize / 2 + 1; }
+
+    // Spectrum indices: 0 .. numChannels - 1 are the input channels.
+    // Mid is channel 0 itself for mono input, and side doesn't exist (-1).
+    int getMidIndex() const noexcept { return numChannels >= 2 ? numChannels : 0; }
+    int getSideIndex() const noexcept { return numChannels >= 2 ? numChannels + 1 : -1; }
+
+    const float* getReal(int index) const noexcept { return real.get() + (size_t)index * (size_t)stride; }
+    const float* getImag(int index) const noexcept { return imag.get() + (size_t)index * (size_t)stride; }
+    const float* getPower(int index) const noexcept { return power.get() + (size_t)index * (size_t)stride; }
+    const float* getMagnitude(int index) const noexcept { return magnitude.get() + (size_t)index * (size_t)stride; }
+
+private:
+    float* realOf(int index) noexcept { return real.get() + (size_t)index * (size_t)stride; }
+    float* imagOf(int index) noexcept { return imag.get() + (size_t)index * (size_t)stride; }
+
+    void transformPair(const float* a, const float* b, const float* window, int indexA, int indexB) noexcept;
+
+    int numChannels = 0;
+    int numSpectra = 0;
+    int fftSize = 0;
+    int stride = 0;
+
+    const juce::dsp::FFT* fft = nullptr;
+    juce::HeapBlock<std::complex<float>> fftIn, fftOut;
+    juce::HeapBlock<float> real, imag, power, magnitude;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ChannelSpectra)
+};
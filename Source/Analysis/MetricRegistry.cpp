@@ -0,0 +1,64 @@
+#include "MetricRegistry.h"
+
+void MetricRegistry::add(Descriptor descriptor)
+{
+    auto index = (size_t)descriptor.id;
+    jassert(index < descriptors.size());
+    jassert(descriptor.compute != nullptr);
+
+    // Dependencies must come earlier, so one pass in id order is a valid schedule
+    jassert(descriptor.dependencies.getBits() >> index == 0);
+
+    if (descriptor.domain == MetricDomain::stream)
+        streamMetrics.add(descriptor.id);
+
+    descriptors[index] = std::move(descriptor);
+}
+
+void MetricRegistry::subscribe(MetricConsumer consumer, MetricSet metrics) noexcept
+{
+    subscriptions[(size_t)consumer].store(metrics.getBits());
+}
+
+void MetricRegistry::update()
+{
+    MetricSet now;
+    for (auto& subscription : subscriptions)
+        now = now | MetricSet(subscription.load());
+
+    if (now == requested)
+        return;
+
+    requested = now;
+    auto resolved = resolveDependencies(requested);
+    auto started = resolved - enabled;
+    enabled = resolved;
+
+    for (auto& descriptor : descriptors)
+        if (started.contains(descriptor.id) && descriptor.restart != nullptr)
+            descriptor.restart();
+}
+
+MetricSet MetricRegistry::resolveDependencies(MetricSet metrics) const noexcept
+{
+    // Downwards, so dependencies of dependencies are still ahead when they get added
+    for (int i = (int)MetricId::numMetrics; --i >= 0;)
+        if (metrics.contains((MetricId)i))
+            metrics = metrics | descriptors[(size_t)i].dependencies;
+
+    return metrics;
+}
+
+void MetricRegistry::computeStream(const MetricInput& input) const
+{
+    for (auto& descriptor : descriptors)
+        if (descriptor.domain == MetricDomain::stream && enabled.contains(descriptor.id))
+            descriptor.compute(input);
+}
+
+void MetricRegistry::computeFrame(const MetricInput& input) const
+{
+    for (auto& descriptor : descriptors)
+        if (descriptor.domain != MetricDomain::stream && enabled.contains(descriptor.id))
+            descriptor.compute(input);
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// ===============================================================================================================
+// Every metric the analysis thread can produce, in dependency order: whatever a metric needs comes before it,
+// so computing the enabled ones in id order always has their inputs ready.
+//
+// The first few are shared intermediates rather than metrics anyone reads. They are pulled in by whatever
+// depends on them and computed once per frame however many metrics share them.
+enum class MetricId
+{
+    // Shared intermediates
+    timeStats,              // Metrics::computeTimeDomainStats, one fused pass
+    spectra,                // every channel's spectrum, batched FFTs
+    midSpectrum,            // the mid spectrum the spectral metrics read
+
+    // Every sample, independent of the STFT
+    loudness,
+    modulation,
+    decay,
+    sweep,
+
+    // Once per frame, time domain
+    rms,
+    peak,
+    crestFactor,
+    transientSharpness,
+    stereoCorrelation,
+
+    // Once per frame, frequency domain
+    spectralCentroid,
+    spectralRolloff,
+    spectralFlatness,
+    resonanceScore,
+    pitch,                  // f0, confidence and HNR
+    bandEnergy,
+    tonalBalance,
+    barkBands,
+    melBands,
+    spectralDynamics,
+    distortion,
+    intermodulation,
+    transferFunction,
+
+    numMetrics
+};
+
+enum class MetricDomain
+{
+    stream,     // sees every sample once, runs on every pull from the fifo
+    time,       // once per STFT frame, on the samples
+    frequency   // once per STFT frame, on the spectrum
+};
+
+// Who reads the metrics. Each consumer owns one subscription, so they never undo each other's.
+enum class MetricConsumer
+{
+    display,    // the editor's metric readout
+    prompt,     // the LLM payload, while the prompt sidebar is open
+    programme,  // the analysis thread itself, for metrics integrated over the whole programme
+    numConsumers
+};
+
+// A set of MetricIds as a bit mask, small enough to publish through one atomic
+class MetricSet
+{
+public:
+    constexpr MetricSet() = default;
+    constexpr explicit MetricSet(uint64_t newBits) : bits(newBits) {}
+    MetricSet(std::initializer_list<MetricId> ids) { for (auto id : ids) bits |= getBit(id); }
+
+    bool contains(MetricId id) const noexcept { return (bits & getBit(id)) != 0; }
+    bool isEmpty() const noexcept { return bits == 0; }
+    uint64_t getBits() const noexcept { return bits; }
+
+    MetricSet operator| (MetricSet other) const noexcept { return MetricSet(bits | other.bits); }
+    MetricSet operator- (MetricSet other) const noexcept { return MetricSet(bits & ~other.bits); }
+    bool operator== (MetricSet other) const noexcept { return bits == other.bits; }
+    bool operator!= (MetricSet other) const noexcept { return bits != other.bits; }
+
+    void add(MetricId id) noexcept { bits |= getBit(id); }
+
+private:
+    static constexpr uint64_t getBit(MetricId id) noexcept { return uint64_t(1) << (int)id; }
+
+    uint64_t bits = 0;
+};
+
+// What a metric gets to work on: the newly pulled samples for MetricDomain::stream, the STFT frame otherwise.
+// reference is the pre-chain stimulus over the same samples.
+struct MetricInput
+{
+    const juce::AudioBuffer<float>& audio;
+    const juce::AudioBuffer<float>& reference;
+    int numSamples = 0;
+};
+
+// ===============================================================================================================
+// Descriptors for every MetricId and the scheduler that runs only the ones some consumer has subscribed to,
+// plus whatever those depend on. A metric nobody reads is never called, so it costs nothing.
+//
+// Consumers subscribe from any thread. The analysis thread picks the change up at its next update(): newly
+// enabled metrics restart first, since whatever history they kept stopped when they were disabled.
+class MetricRegistry
+{
+public:
+    using Compute = std::function<void(const MetricInput&)>;
+
+    struct Descriptor
+    {
+        MetricId id = MetricId::numMetrics;
+        const char* name = "";          // human readable
+        MetricDomain domain = MetricDomain::frequency;
+        MetricSet dependencies;         // ids before this one
+        Compute compute;
+        std::function<void()> restart;  // optional, clears any history
+    };
+
+    MetricRegistry() = default;
+
+    // Once per id, before the analysis thread starts
+    void add(Descriptor descriptor);
+
+    const Descriptor& getDescriptor(MetricId id) const noexcept { return descriptors[(size_t)id]; }
+
+    // Any thread. Replaces the consumer's previous subscription, an empty set unsubscribes.
+    void subscribe(MetricConsumer consumer, MetricSet metrics) noexcept;
+
+    // =============================
+    // Analysis thread
+    // =============================
+    // Folds in subscription changes, restarting metrics that just became enabled
+    void update();
+
+    // The enabled stream metrics, and the enabled time and frequency ones, each in dependency order
+    void computeStream(const MetricInput& input) const;
+    void computeFrame(const MetricInput& input) const;
+
+    bool isEnabled(MetricId id) const noexcept { return enabled.contains(id); }
+    bool hasFrameMetrics() const noexcept { return !(enabled - streamMetrics).isEmpty(); }
+
+private:
+    MetricSet resolveDependencies(MetricSet metrics) const noexcept;
+
+    std::array<Descriptor, (size_t)MetricId::numMetrics> descriptors;
+    MetricSet streamMetrics;
+
+    std::array<std::atomic<uint64_t>, (size_t)MetricConsumer::numConsumers> subscriptions{};
+    MetricSet requested, enabled;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(MetricRegistry)
+};
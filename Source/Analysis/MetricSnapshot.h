@@ -0,0 +1,63 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "../Metrics/Metrics.h"
+#include "../Metrics/DecayMeter.h"
+#include "../Metrics/IntermodulationMeter.h"
+#include "../Metrics/SpectralDynamics.h"
+#include "../Metrics/SweepMeter.h"
+
+// ===============================================================================================================
+// Every metric value the analysis thread produces, as one frame's worth. The analysis thread fills its own
+// copy and publishes it whole through a TripleBuffer, so a reader always gets values from the same pass.
+// Metrics nobody subscribes to keep whatever they last read.
+struct MetricSnapshot
+{
+    int64_t frameNumber = 0;           // STFT frames analysed since prepare
+    int64_t samplePosition = 0;        // samples analysed since prepare, up to and including this snapshot
+    double timestamp = 0.0;            // juce::Time::getMillisecondCounterHiRes() at publication
+
+    float spectral_centroid = 0.f;
+    float spectral_rolloff = 0.f;
+    float spectral_flatness = 0.f;
+    float resonance_score = 0.f;
+    float harmonic_to_noise = 0.f;     // dB
+    float fundamental_frequency = 0.f; // Hz, 0 when unpitched
+    float pitch_confidence = 0.f;      // 0 .. 1
+    float rms = 0.f;
+    float lufs = 0.f;                  // integrated, BS.1770-4 gated
+    float lufs_momentary = 0.f;
+    float lufs_short_term = 0.f;
+    float loudness_range = 0.f;        // LU
+    float peak = 0.f;
+    float crest_factor = 0.f;
+    float transient_sharpness = 0.f;
+    float decay_time = 0.f;            // s, RT60 from T30 (or T20), impulse train only
+    float early_decay_time = 0.f;      // s, EDT
+    std::array<float, DecayMeter::numOctaveBands> octave_decay_times{};   // s, RT60 per octave, 63 Hz up
+    float stereo_correlation = 0.f;
+    float modulation_depth = 0.f;      // AM index of the ~200 Hz envelope, 1 = sine LFO to silence
+    float modulation_rate = 0.f;       // Hz, 0 when nothing periodic
+    std::array<float, 3> band_energy{};                                    // low, mid, high power
+    std::array<float, Filterbank::numThirdOctaveBands> tonal_balance{};    // dB re. total power
+    std::array<float, Filterbank::numBarkBands> bark_bands{};              // power
+    std::array<float, Filterbank::numMelBands> mel_bands{};                // power
+    float thd = 0.f;                   // %, sine stimulus only
+    float thd_plus_noise = 0.f;        // %, sine stimulus only
+    std::array<float, Metrics::HarmonicAnalysis::maxHarmonics> harmonic_levels{};  // dB re. fundamental, 2nd up
+    float imd = 0.f;                   // %, two-tone stimuli only
+    int imd_num_products = 0;
+    std::array<float, IntermodulationMeter::maxProducts> imd_product_frequencies{};  // Hz
+    std::array<float, IntermodulationMeter::maxProducts> imd_product_levels{};       // dB re. reference tone(s)
+    int num_dynamics_bands = 0;
+    std::array<float, SpectralDynamics::maxBands> band_level_range{};       // dB, max - min over the history
+    std::array<float, SpectralDynamics::maxBands> band_level_deviation{};   // dB, standard deviation
+    std::array<float, Filterbank::numThirdOctaveBands> frequency_response{};  // dB, |H1| per third octave, broadband stimuli only
+    std::array<float, Filterbank::numThirdOctaveBands> phase_response{};      // radians
+    std::array<float, Filterbank::numThirdOctaveBands> group_delay{};         // ms
+    std::array<float, Filterbank::numThirdOctaveBands> coherence{};           // 0 .. 1, how far to trust the three above
+    std::array<float, Filterbank::numThirdOctaveBands> sweep_response{};      // dB, linear IR per third octave, log sweep only
+    std::array<float, SweepMeter::maxHarmonic - 1> sweep_harmonic_levels{};   // dB re. linear response, 2nd up
+    float sweep_thd = 0.f;             // %, log sweep only
+    float sweep_latency = 0.f;         // ms, reported plus measured
+};
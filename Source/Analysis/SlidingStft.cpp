@@ -0,0 +1,105 @@
+#include "SlidingStft.h"
+
+void SlidingStft::prepare(int numChannels, const FftPlan& plan, int newNumReferenceChannels)
+{
+    numAudioChannels = juce::jmax(1, numChannels);
+    numReferenceChannels = juce::jmax(0, newNumReferenceChannels);
+    fftSize = plan.getSize();
+    window = plan.getWindow();
+
+    ring.setSize(numAudioChannels + numReferenceChannels, 2 * fftSize);
+    framePointers.allocate((size_t)numAudioChannels, true);
+    latestPointers.allocate((size_t)numAudioChannels, true);
+    referencePointers.allocate((size_t)juce::jmax(1, numReferenceChannels), true);
+    latestReferencePointers.allocate((size_t)juce::jmax(1, numReferenceChannels), true);
+    reset();
+}
+
+void SlidingStft::setWindow(const FftPlan& plan) noexcept
+{
+    jassert(plan.getSize() == fftSize);
+    window = plan.getWindow();
+}
+
+void SlidingStft::reset()
+{
+    ring.clear();
+    writePosition = 0;
+    numValid = 0;
+    samplesSinceFrame = 0;
+}
+
+void SlidingStft::setOverlap(int newOverlap)
+{
+    jassert(newOverlap == 2 || newOverlap == 4 || newOverlap == 8);
+    overlap.store(juce::jlimit(1, 8, newOverlap), std::memory_order_relaxed);
+}
+
+// =============================
+// Analysis thread
+// =============================
+int SlidingStft::pull(AnalysisFifo& fifo)
+{
+    auto toNextFrame = numValid < fftSize ? fftSize - numValid
+                                          : juce::jmax(0, getHopSize() - samplesSinceFrame);
+
+    auto numToRead = juce::jmin(fifo.getNumReady(), fftSize - writePosition, toNextFrame);
+    if (numToRead <= 0)
+        return 0;
+
+    auto numRead = fifo.pop(ring, writePosition, numToRead);
+
+    // Mirror into the upper half so the newest fftSize samples are always contiguous
+    for (int ch = 0; ch < ring.getNumChannels(); ++ch)
+    {
+        auto* data = ring.getWritePointer(ch);
+        std::memcpy(data + writePosition + fftSize, data + writePosition, sizeof(float) * (size_t)numRead);
+    }
+
+    writePosition = (writePosition + numRead) % fftSize;
+    numValid = juce::jmin(fftSize, numValid + numRead);
+    samplesSinceFrame += numRead;
+    return numRead;
+}
+
+const juce::AudioBuffer<float>& SlidingStft::takeFrame() noexcept
+{
+    for (int ch = 0; ch < numAudioChannels; ++ch)
+        framePointers[ch] = ring.getWritePointer(ch) + writePosition;
+
+    frame.setDataToReferTo(framePointers.get(), numAudioChannels, fftSize);
+    samplesSinceFrame = 0;
+    return frame;
+}
+
+const juce::AudioBuffer<float>& SlidingStft::getReferenceFrame() noexcept
+{
+    for (int ch = 0; ch < numReferenceChannels; ++ch)
+        referencePointers[ch] = ring.getWritePointer(numAudioChannels + ch) + writePosition;
+
+    referenceFrame.setDataToReferTo(referencePointers.get(), numReferenceChannels, fftSize);
+    return referenceFrame;
+}
+
+const juce::AudioBuffer<float>& SlidingStft::viewLatest(int numSamples) noexcept
+{
+    jassert(numSamples <= fftSize);
+
+    // Thanks to the mirror the newest samples always end, contiguously, at writePosition + fftSize
+    for (int ch = 0; ch < numAudioChannels; ++ch)
+        latestPointers[ch] = ring.getWritePointer(ch) + writePosition + fftSize - numSamples;
+
+    latest.setDataToReferTo(latestPointers.get(), numAudioChannels, numSamples);
+    return latest;
+}
+
+const juce::AudioBuffer<float>& SlidingStft::viewLatestReference(int numSamples) noexcept
+{
+    jassert(numSamples <= fftSize);
+
+    for (int ch = 0; ch < numReferenceChannels; ++ch)
+        latestReferencePointers[ch] = ring.getWritePointer(numAudioChannels + ch) + writePosition + fftSize - numSamples;
+
+    latestReference.setDataToReferTo(latestReferencePointers.get(), numReferenceChannels, numSamples);
+    return latestReference;
+}
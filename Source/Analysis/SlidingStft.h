@@ -0,0 +1,81 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "AnalysisFifo.h"
+#include "../Metrics/FftPlan.h"
+
+// ===============================================================================================================
+// Overlapping STFT framing for the analysis thread.
+// Every channel keeps the last fftSize samples in a mirrored ring (each sample is stored at i and i + fftSize),
+// so the newest frame is always one contiguous block and advancing by a hop costs two hop-sized copies.
+// A frame is ready every fftSize / overlap samples once the history has filled up. The FFTs themselves are
+// batched over all channels by ChannelSpectra.
+// Reference channels from the fifo share the ring, so their frame always covers the same samples.
+class SlidingStft
+{
+public:
+    enum
+    {
+        defaultOverlap = 4 // 75 %
+    };
+
+    SlidingStft() = default;
+
+    // Allocates. Size and window come from plan, which must outlive this. Analysis thread or while it is stopped.
+    void prepare(int numChannels, const FftPlan& plan, int newNumReferenceChannels = 0);
+    // Another window at the same size. Keeps the history, so the next frame comes on time.
+    void setWindow(const FftPlan& plan) noexcept;
+    void reset();
+
+    // 2 (50 %), 4 (75 %) or 8 (87.5 %). Safe from any thread, takes effect from the next hop.
+    void setOverlap(int newOverlap);
+    int getOverlap() const noexcept { return overlap.load(std::memory_order_relaxed); }
+
+    int getFftSize() const noexcept { return fftSize; }
+    int getHopSize() const noexcept { return fftSize / getOverlap(); }
+
+    // =============================
+    // Analysis thread
+    // =============================
+    // Moves samples from the fifo into the history, never past the end of the next frame. Returns how many.
+    int pull(AnalysisFifo& fifo);
+    bool isFrameReady() const noexcept { return numValid == fftSize && samplesSinceFrame >= getHopSize(); }
+
+    // The newest fftSize samples of every channel, oldest first. Marks the frame as consumed.
+    const juce::AudioBuffer<float>& takeFrame() noexcept;
+
+    // The reference channels over the same samples as the last takeFrame()
+    const juce::AudioBuffer<float>& getReferenceFrame() noexcept;
+
+    // The last numSamples (<= fftSize) samples pulled, for consumers that must see every sample exactly once
+    const juce::AudioBuffer<float>& viewLatest(int numSamples) noexcept;
+    const juce::AudioBuffer<float>& viewLatestReference(int numSamples) noexcept;
+
+    // The plan's window, fftSize values
+    const float* getWindow() const noexcept { return window; }
+
+private:
+    int fftSize = 0;
+    const float* window = nullptr;
+
+    int numAudioChannels = 0;
+    int numReferenceChannels = 0;
+
+    juce::AudioBuffer<float> ring;          // (audio + reference channels) x (2 * fftSize)
+    juce::AudioBuffer<float> frame;         // view into ring, rebuilt by takeFrame()
+    juce::HeapBlock<float*> framePointers;
+    juce::AudioBuffer<float> referenceFrame;
+    juce::HeapBlock<float*> referencePointers;
+    juce::AudioBuffer<float> latest;        // view into ring, rebuilt by viewLatest()
+    juce::HeapBlock<float*> latestPointers;
+    juce::AudioBuffer<float> latestReference;
+    juce::HeapBlock<float*> latestReferencePointers;
+
+    int writePosition = 0;                  // in [0, fftSize)
+    int numValid = 0;                       // samples of history, up to fftSize
+    int samplesSinceFrame = 0;
+
+    std::atomic<int> overlap{ defaultOverlap };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SlidingStft)
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// ===============================================================================================================
+// Hands whole values from one writer thread to one reader thread without either ever waiting on the other.
+//
+// Three slots: the writer fills its back slot and swaps it with the middle one in a single atomic exchange,
+// the reader swaps the middle one into its front slot only if something newer was published. Neither side
+// touches the other's slot, so a read never sees half of one publish and half of the next, and the reader
+// just keeps its last value when the writer hasn't published since.
+template <typename Value>
+class TripleBuffer
+{
+public:
+    TripleBuffer() = default;
+
+    // Writer thread. Copies value in and makes it the latest.
+    void publish(const Value& value) noexcept
+    {
+        slots[(size_t)backIndex] = value;
+        backIndex = middle.exchange(backIndex | freshFlag, std::memory_order_acq_rel) & indexMask;
+    }
+
+    // Reader thread. The latest published value, unchanged until the reader's next read().
+    const Value& read() noexcept
+    {
+        if ((middle.load(std::memory_order_relaxed) & freshFlag) != 0)
+            frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & indexMask;
+
+        return slots[(size_t)frontIndex];
+    }
+
+private:
+    enum
+    {
+        indexMask = 3,
+        freshFlag = 4       // set on the middle index by publish(), cleared by read()
+    };
+
+    std::array<Value, 3> slots{};
+    int backIndex = 0;                  // writer only
+    std::atomic<int> middle{ 1 };
+    int frontIndex = 2;                 // reader only
+
+    JUCE_DECLARE_NON_COPYABLE(TripleBuffer)
+};
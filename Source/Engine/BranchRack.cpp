@@ -0,0 +1,445 @@
+#include "BranchRack.h"
+
+namespace
+{
+    // What one event takes up in a MidiBuffer: its time, its size and the message
+    int getMidiEventBytes(const juce::MidiMessageMetadata& event) noexcept
+    {
+        return (int)(sizeof(juce::int32) + sizeof(juce::uint16)) + event.numBytes;
+    }
+
+    bool isSameEvent(const juce::MidiMessageMetadata& a, const juce::MidiMessageMetadata& b) noexcept
+    {
+        return a.samplePosition == b.samplePosition && a.numBytes == b.numBytes
+            && std::memcmp(a.data, b.data, (size_t)a.numBytes) == 0;
+    }
+
+    // Replaces dest's events with source's, up to PluginChain::midiBufferBytes. The rest is dropped rather
+    // than growing dest on the audio or a render thread.
+    void copyMidi(juce::MidiBuffer& dest, const juce::MidiBuffer& source) noexcept
+    {
+        dest.clear();
+
+        int bytes = 0;
+        for (const auto event : source)
+        {
+            bytes += getMidiEventBytes(event);
+            if (bytes > PluginChain::midiBufferBytes)
+                break;
+
+            dest.addEvent(event.data, event.numBytes, event.samplePosition);
+        }
+    }
+}
+
+// =============================
+// Branch
+// =============================
+void BranchRack::Branch::prepare(double sampleRate, int maximumBlockSize, int numChannels)
+{
+    buffer.setSize(numChannels, juce::jmax(1, maximumBlockSize));
+    midi.ensureSize(PluginChain::midiBufferBytes);
+    chain.prepare(sampleRate, maximumBlockSize, numChannels);
+
+    juce::dsp::ProcessSpec spec{ sampleRate, (juce::uint32)juce::jmax(1, maximumBlockSize), (juce::uint32)numChannels };
+    lowCut.setType(juce::dsp::LinkwitzRileyFilterType::highpass);
+    highCut.setType(juce::dsp::LinkwitzRileyFilterType::lowpass);
+    lowCut.prepare(spec);
+    highCut.prepare(spec);
+    crossfadeLength = juce::jmax(1, juce::roundToInt(sampleRate * PluginChain::crossfadeMs * 0.001));
+
+    // The filters start from cleared state anyway, so whatever band is set applies straight away
+    currentLowCut = currentHighCut = 0.0f;
+    lowCutMix = highCutMix = 0.0f;
+    updateCrossover(lowCut, currentLowCut, 0.0f, lowCutHz.load());
+    updateCrossover(highCut, currentHighCut, 0.0f, highCutHz.load());
+    lowCutMix = currentLowCut > 0.0f ? 1.0f : 0.0f;
+    highCutMix = currentHighCut > 0.0f ? 1.0f : 0.0f;
+
+    if (compensation == nullptr)
+        compensation = std::make_unique<LatencyDelay>();
+    compensation->setDelay(numChannels, compensation->getDelay());
+}
+
+void BranchRack::Branch::render() noexcept
+{
+    auto numCh = juce::jmin(buffer.getNumChannels(), input->getNumChannels());
+    juce::AudioBuffer<float> view(buffer.getArrayOfWritePointers(), numCh, numSamples);
+
+    for (int ch = 0; ch < numCh; ++ch)
+        view.copyFrom(ch, 0, *input, ch, 0, numSamples);
+
+    // Multiband split: Linkwitz-Riley bands sum back flat when neighbouring branches share a crossover
+    auto low = lowCutHz.load();
+    auto high = highCutHz.load();
+    updateCrossover(lowCut, currentLowCut, lowCutMix, low);
+    updateCrossover(highCut, currentHighCut, highCutMix, high);
+    applyCrossover(lowCut, lowCutMix, low > 0.0f, view);
+    applyCrossover(highCut, highCutMix, high > 0.0f, view);
+
+    // Faded out completely: the next switch on starts the filter afresh, whatever its cutoff
+    if (lowCutMix == 0.0f)
+        currentLowCut = 0.0f;
+    if (highCutMix == 0.0f)
+        currentHighCut = 0.0f;
+
+    chain.process(view, midi);
+    compensation->process(view, numSamples);
+}
+
+void BranchRack::Branch::updateCrossover(juce::dsp::LinkwitzRileyFilter<float>& filter, float& current, float mix, float hz) noexcept
+{
+    // Switched off: keep the old cutoff while the side fades out
+    if (hz <= 0.0f || hz == current)
+        return;
+
+    // Only a side coming back from fully off starts from cleared state, a running one is retuned in place
+    if (mix == 0.0f)
+        filter.reset();
+
+    filter.setCutoffFrequency(hz);
+    current = hz;
+}
+
+void BranchRack::Branch::applyCrossover(juce::dsp::LinkwitzRileyFilter<float>& filter, float& mix, bool enabled,
+                                        juce::AudioBuffer<float>& view) noexcept
+{
+    auto target = enabled ? 1.0f : 0.0f;
+    if (mix == 0.0f && target == 0.0f)
+        return;
+
+    auto numCh = view.getNumChannels();
+    auto length = view.getNumSamples();
+
+    if (mix == target)
+    {
+        for (int ch = 0; ch < numCh; ++ch)
+        {
+            auto* data = view.getWritePointer(ch);
+            for (int n = 0; n < length; ++n)
+                data[n] = filter.processSample(ch, data[n]);
+        }
+        return;
+    }
+
+    // Crossfade between the unfiltered and filtered signal, at the same rate as a plugin swap
+    auto step = (target > mix ? 1.0f : -1.0f) / (float)crossfadeLength;
+    auto endMix = mix;
+    for (int ch = 0; ch < numCh; ++ch)
+    {
+        auto* data = view.getWritePointer(ch);
+        auto gain = mix;
+        for (int n = 0; n < length; ++n)
+        {
+            gain = juce::jlimit(0.0f, 1.0f, gain + step);
+            auto filtered = filter.processSample(ch, data[n]);
+            data[n] += gain * (filtered - data[n]);
+        }
+        endMix = gain;
+    }
+
+    mix = endMix;
+}
+
+// =============================
+// BranchRack
+// =============================
+BranchRack::BranchRack(const juce::CriticalSection& callbackLockToUse)
+    : callbackLock(callbackLockToUse),
+      pool(juce::jlimit(0, (int)maxBranches - 1, juce::SystemStats::getNumCpus() - 1))
+{
+    branches.ensureStorageAllocated(maxBranches);
+    inputMidi.ensureSize(PluginChain::midiBufferBytes);
+
+    // The main serial chain
+    addBranch();
+}
+
+BranchRack::~BranchRack()
+{
+    pool.stop();
+}
+
+void BranchRack::prepare(double newSampleRate, int newMaximumBlockSize, int newNumChannels)
+{
+    pool.stop();
+
+    sampleRate = newSampleRate;
+    maximumBlockSize = newMaximumBlockSize;
+    numChannels = juce::jmax(1, newNumChannels);
+
+    for (auto* branch : branches)
+        branch->prepare(sampleRate, maximumBlockSize, numChannels);
+
+    updateLatencyCompensation();
+    pool.start(sampleRate, maximumBlockSize);
+}
+
+void BranchRack::releaseResources()
+{
+    pool.stop();
+
+    for (auto* branch : branches)
+        branch->chain.releaseResources();
+}
+
+// =============================
+// Message thread
+// =============================
+int BranchRack::addBranch()
+{
+    if (branches.size() >= maxBranches)
+        return -1;
+
+    auto branch = std::make_unique<Branch>(callbackLock);
+    branch->compensation = std::make_unique<LatencyDelay>();
+    if (sampleRate > 0.0)
+        branch->prepare(sampleRate, maximumBlockSize, numChannels);
+
+    int index;
+    {
+        const juce::ScopedLock sl(callbackLock);
+        index = branches.size();
+        branches.add(branch.release());
+    }
+
+    balanceGains();
+    updateLatencyCompensation();
+    return index;
+}
+
+void BranchRack::removeBranch(int index)
+{
+    if (!juce::isPositiveAndBelow(index, branches.size()) || index == 0)
+    {
+        jassertfalse; // the main chain stays, whatever else goes
+        return;
+    }
+
+    std::unique_ptr<Branch> branch;
+    {
+        const juce::ScopedLock sl(callbackLock);
+        branch.reset(branches.removeAndReturn(index));
+    }
+
+    balanceGains();
+    updateLatencyCompensation();
+}
+
+void BranchRack::balanceGains() noexcept
+{
+    // The audio thread ramps from each branch's last gain, so the change doesn't click
+    auto gain = 1.0f / (float)juce::jmax(1, branches.size());
+    for (auto* branch : branches)
+        branch->gain.store(gain);
+}
+
+PluginChain* BranchRack::getChain(int index) const noexcept
+{
+    if (auto* branch = branches[index])
+        return &branch->chain;
+    return nullptr;
+}
+
+void BranchRack::setBranchGain(int index, float newGain)
+{
+    if (auto* branch = branches[index])
+        branch->gain.store(newGain);
+}
+
+void BranchRack::setBranchBand(int index, float lowCutHz, float highCutHz)
+{
+    if (auto* branch = branches[index])
+    {
+        branch->lowCutHz.store(juce::jmax(0.0f, lowCutHz));
+        branch->highCutHz.store(juce::jmax(0.0f, highCutHz));
+    }
+}
+
+void BranchRack::updateLatencyCompensation()
+{
+    auto maxLatency = getTotalLatency();
+
+    for (auto* branch : branches)
+    {
+        auto needed = maxLatency - branch->chain.getTotalLatency();
+        if (branch->compensation != nullptr && branch->compensation->getDelay() == needed)
+            continue;
+
+        // Allocate the new line first, swap it in under the lock, free the old one afterwards. The new line
+        // carries on from the old one's history and fades across the change rather than restarting silent.
+        auto oldDelay = branch->compensation != nullptr ? branch->compensation->getDelay() : 0;
+        auto newDelay = std::make_unique<LatencyDelay>();
+        newDelay->setDelay(numChannels, needed, oldDelay);
+        {
+            const juce::ScopedLock sl(callbackLock);
+            if (branch->compensation != nullptr)
+                newDelay->continueFrom(*branch->compensation, branch->crossfadeLength);
+            std::swap(branch->compensation, newDelay);
+        }
+    }
+}
+
+int BranchRack::getTotalLatency() const noexcept
+{
+    int maxLatency = 0;
+    for (auto* branch : branches)
+        maxLatency = juce::jmax(maxLatency, branch->chain.getTotalLatency());
+    return maxLatency;
+}
+
+juce::AudioPluginInstance* BranchRack::getLastPlugin() const noexcept
+{
+    for (int i = branches.size(); --i >= 0;)
+        if (auto* plugin = branches.getUnchecked(i)->chain.getLastPlugin())
+            return plugin;
+
+    return nullptr;
+}
+
+juce::String BranchRack::getDescription() const
+{
+    juce::StringArray names;
+    for (auto* branch : branches)
+        names.add(branch->chain.size() > 0 ? branch->chain.getDescription() : juce::String("Dry"));
+    return names.joinIntoString(" | ");
+}
+
+std::unique_ptr<juce::AudioPluginInstance> BranchRack::popRetiredPlugin()
+{
+    for (auto* branch : branches)
+        if (auto plugin = branch->chain.popRetiredPlugin())
+            return plugin;
+
+    return {};
+}
+
+// =============================
+// Audio thread
+// =============================
+void BranchRack::process(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midi) noexcept
+{
+    auto numBranches = branches.size();
+    auto numSamples = buffer.getNumSamples();
+    if (numBranches == 0)
+        return;
+
+    if (numSamples > maximumBlockSize)
+    {
+        jassertfalse; // host broke its maximum block size promise
+        return;
+    }
+
+    for (int i = 0; i < numBranches; ++i)
+    {
+        auto* branch = branches.getUnchecked(i);
+        branch->input = &buffer;
+        branch->numSamples = numSamples;
+        jobs[i] = branch;
+
+        // Bounded by what Branch::prepare reserved, so this only copies
+        copyMidi(branch->midi, midi);
+    }
+
+    // One branch renders inline, several fan out over the worker threads
+    pool.render(jobs, numBranches);
+
+    // Merge
+    for (int i = 0; i < numBranches; ++i)
+    {
+        auto* branch = branches.getUnchecked(i);
+        auto gain = branch->gain.load();
+        auto numBranchChannels = juce::jmin(buffer.getNumChannels(), branch->buffer.getNumChannels());
+
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+        {
+            if (ch >= numBranchChannels)
+            {
+                if (i == 0)
+                    buffer.clear(ch, 0, numSamples);
+                continue;
+            }
+
+            if (i == 0)
+                buffer.copyFromWithRamp(ch, 0, branch->buffer.getReadPointer(ch), numSamples, branch->lastGain, gain);
+            else
+                buffer.addFromWithRamp(ch, 0, branch->buffer.getReadPointer(ch), numSamples, branch->lastGain, gain);
+        }
+
+        branch->lastGain = gain;
+    }
+
+    mergeMidi(midi, numBranches);
+}
+
+void BranchRack::mergeMidi(juce::MidiBuffer& midi, int numBranches) noexcept
+{
+    if (numBranches == 1)
+    {
+        copyMidi(midi, branches.getUnchecked(0)->midi);
+        return;
+    }
+
+    // midi is about to become the output, the pass-through is matched against a copy of the input
+    copyMidi(inputMidi, midi);
+
+    for (int i = 0; i < numBranches; ++i)
+    {
+        auto& branchMidi = branches.getUnchecked(i)->midi;
+        midiCursors[(size_t)i] = { branchMidi.cbegin(), branchMidi.cend(), inputMidi.cbegin() };
+    }
+
+    // Steps over a branch's copies of input events. Both run in time order, so each branch event is only
+    // looked for among the input events at its own sample position, past the ones already matched. Every input
+    // event accounts for one copy at most: an identical event a branch generates on top still gets out.
+    auto skipPassThrough = [this](MidiCursor& cursor)
+    {
+        while (cursor.next != cursor.end)
+        {
+            auto event = *cursor.next;
+            while (cursor.input != inputMidi.cend() && (*cursor.input).samplePosition < event.samplePosition)
+                ++cursor.input;
+
+            auto match = cursor.input;
+            while (match != inputMidi.cend() && (*match).samplePosition == event.samplePosition
+                   && !isSameEvent(*match, event))
+                ++match;
+
+            if (match == inputMidi.cend() || (*match).samplePosition != event.samplePosition)
+                return;
+
+            cursor.input = ++match;
+            ++cursor.next;
+        }
+    };
+
+    // One ordered pass over every branch at once, the main branch first among events at the same position
+    midi.clear();
+    int bytes = 0;
+    for (;;)
+    {
+        MidiCursor* earliest = nullptr;
+        for (int i = 0; i < numBranches; ++i)
+        {
+            auto& cursor = midiCursors[(size_t)i];
+            if (i > 0)
+                skipPassThrough(cursor);
+
+            if (cursor.next != cursor.end
+                && (earliest == nullptr || (*cursor.next).samplePosition < (*earliest->next).samplePosition))
+                earliest = &cursor;
+        }
+
+        if (earliest == nullptr)
+            break;
+
+        auto event = *earliest->next;
+        ++earliest->next;
+
+        bytes += getMidiEventBytes(event);
+        if (bytes > PluginChain::midiBufferBytes)
+            break;
+
+        midi.addEvent(event.data, event.numBytes, event.samplePosition);
+    }
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginChain.h"
+#include "LatencyDelay.h"
+#include "RenderThreadPool.h"
+
+// ===============================================================================================================
+// Parallel branches (dry/wet splits, multiband splits) that each run their own serial PluginChain.
+// Every branch renders into its own preallocated buffer; with more than one branch they render concurrently
+// on the RenderThreadPool and are summed back on the audio thread. Shorter branches are delayed to match the
+// slowest one so the sum stays phase coherent, and that maximum is what the processor reports as latency.
+// Every branch gets the host's MIDI. The MIDI sent back is the main branch's output merged in time order with
+// whatever the other branches generated themselves; their pass-through copies of the input are dropped, so it
+// doesn't double up. Every MIDI buffer reserves PluginChain::midiBufferBytes and events past that are dropped,
+// so copying MIDI around never allocates on the audio or a render thread.
+class BranchRack
+{
+public:
+    enum
+    {
+        maxBranches = 16
+    };
+
+    explicit BranchRack(const juce::CriticalSection& callbackLockToUse);
+    ~BranchRack();
+
+    void prepare(double newSampleRate, int newMaximumBlockSize, int newNumChannels);
+    void releaseResources();
+
+    // =============================
+    // Message thread
+    // =============================
+    // Adding or removing a branch sets every branch's gain to 1 / size(), so a dry/wet split sums to unity
+    // instead of doubling up. setBranchGain() overrides it until the next change.
+    // Returns the index of the new branch, or -1 if the rack is full
+    int addBranch();
+    // Index 0 is the main chain and can't be removed
+    void removeBranch(int index);
+
+    int size() const noexcept { return branches.size(); }
+    PluginChain* getChain(int index) const noexcept;
+
+    void setBranchGain(int index, float newGain);
+    // Band limits for multiband splits, 0 disables that side of the band
+    void setBranchBand(int index, float lowCutHz, float highCutHz);
+
+    // Call after any branch's plugins changed
+    void updateLatencyCompensation();
+    int getTotalLatency() const noexcept;
+
+    juce::AudioPluginInstance* getLastPlugin() const noexcept;
+    juce::String getDescription() const; // branches separated by " | "
+
+    // Plugins any branch has swapped out. Destroy them on the message thread.
+    std::unique_ptr<juce::AudioPluginInstance> popRetiredPlugin();
+
+    // =============================
+    // Audio thread
+    // =============================
+    void process(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midi) noexcept;
+
+private:
+    void mergeMidi(juce::MidiBuffer& midi, int numBranches) noexcept;
+    void balanceGains() noexcept;
+
+    struct Branch : public RenderThreadPool::Job
+    {
+        explicit Branch(const juce::CriticalSection& callbackLock) : chain(callbackLock) {}
+
+        void prepare(double sampleRate, int maximumBlockSize, int numChannels);
+        void render() noexcept override;
+
+        PluginChain chain;
+        juce::AudioBuffer<float> buffer;
+        juce::MidiBuffer midi;
+
+        std::atomic<float> gain{ 1.0f };
+        float lastGain = 1.0f;
+
+        // Multiband split. Cutoff changes retune the filters in place; switching a side on or off fades it
+        // over PluginChain::crossfadeMs, mix 1 being fully filtered.
+        std::atomic<float> lowCutHz{ 0.0f }, highCutHz{ 0.0f };
+        float currentLowCut = 0.0f, currentHighCut = 0.0f;
+        float lowCutMix = 0.0f, highCutMix = 0.0f;
+        int crossfadeLength = 1;
+        juce::dsp::LinkwitzRileyFilter<float> lowCut, highCut;
+
+        void updateCrossover(juce::dsp::LinkwitzRileyFilter<float>& filter, float& current, float mix, float hz) noexcept;
+        void applyCrossover(juce::dsp::LinkwitzRileyFilter<float>& filter, float& mix, bool enabled,
+                            juce::AudioBuffer<float>& view) noexcept;
+
+        std::unique_ptr<LatencyDelay> compensation;
+
+        // Set by the audio thread right before rendering
+        const juce::AudioBuffer<float>* input = nullptr;
+        int numSamples = 0;
+    };
+
+    const juce::CriticalSection& callbackLock;
+    juce::OwnedArray<Branch> branches;
+    RenderThreadPool pool;
+
+    double sampleRate = 0.0;
+    int maximumBlockSize = 0;
+    int numChannels = 2;
+
+    RenderThreadPool::Job* jobs[maxBranches] = {};
+    juce::MidiBuffer inputMidi;     // the host's events for this block, preallocated
+
+    // Where mergeMidi() is in one branch's MIDI, and in the input it matches that branch's pass-through against
+    struct MidiCursor
+    {
+        juce::MidiBufferIterator next, end, input;
+    };
+
+    std::array<MidiCursor, maxBranches> midiCursors;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(BranchRack)
+};
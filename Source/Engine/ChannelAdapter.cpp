@@ -0,0 +1,111 @@
+#include "ChannelAdapter.h"
+
+void ChannelAdapter::prepare(int maximumBlockSize)
+{
+    scratch.setSize(maxPluginChannels, juce::jmax(1, maximumBlockSize), false, true, false);
+}
+
+void ChannelAdapter::releaseResources()
+{
+    scratch.setSize(0, 0);
+}
+
+void ChannelAdapter::process(juce::AudioProcessor& plugin, juce::AudioBuffer<float>& hostBuffer, juce::MidiBuffer& midi) noexcept
+{
+    auto numSamples = hostBuffer.getNumSamples();
+    auto numHostChannels = hostBuffer.getNumChannels();
+    auto pluginIns = plugin.getTotalNumInputChannels();
+    auto pluginOuts = plugin.getTotalNumOutputChannels();
+    auto numPluginChannels = juce::jmax(pluginIns, pluginOuts);
+
+    // Layouts already agree: let the plugin work directly on the host buffer
+    if (pluginIns == numHostChannels && pluginOuts == numHostChannels)
+    {
+        plugin.processBlock(hostBuffer, midi);
+        return;
+    }
+
+    // Adapting would need more scratch than prepare() gave us, leave the signal untouched rather than allocate
+    if (numPluginChannels > scratch.getNumChannels() || numSamples > scratch.getNumSamples())
+    {
+        jassertfalse;
+        return;
+    }
+
+    // Refers to the scratch channels, at most 32 channel pointers are kept inline so this doesn't allocate
+    juce::AudioBuffer<float> pluginBuffer(scratch.getArrayOfWritePointers(), numPluginChannels, numSamples);
+
+    mix(hostBuffer, numHostChannels, pluginBuffer, pluginIns, numSamples);
+    for (int ch = pluginIns; ch < numPluginChannels; ++ch)
+        pluginBuffer.clear(ch, 0, numSamples);
+
+    plugin.processBlock(pluginBuffer, midi);
+
+    mix(pluginBuffer, pluginOuts, hostBuffer, numHostChannels, numSamples);
+}
+
+void ChannelAdapter::mix(const juce::AudioBuffer<float>& source, int numSourceChannels,
+                         juce::AudioBuffer<float>& dest, int numDestChannels, int numSamples) noexcept
+{
+    constexpr float minus3dB = 0.70710678f;
+    constexpr float minus6dB = 0.5f;
+
+    if (numDestChannels <= 0)
+        return;
+
+    if (numSourceChannels <= 0)
+    {
+        for (int ch = 0; ch < numDestChannels; ++ch)
+            dest.clear(ch, 0, numSamples);
+        return;
+    }
+
+    // N -> 1: average
+    if (numDestChannels == 1)
+    {
+        dest.copyFrom(0, 0, source, 0, 0, numSamples);
+        for (int ch = 1; ch < numSourceChannels; ++ch)
+            dest.addFrom(0, 0, source, ch, 0, numSamples);
+
+        if (numSourceChannels > 1)
+            dest.applyGain(0, 0, numSamples, 1.0f / (float)numSourceChannels);
+        return;
+    }
+
+    // 1 -> N: mono into L and R
+    if (numSourceChannels == 1)
+    {
+        dest.copyFrom(0, 0, source, 0, 0, numSamples);
+        dest.copyFrom(1, 0, source, 0, 0, numSamples);
+        for (int ch = 2; ch < numDestChannels; ++ch)
+            dest.clear(ch, 0, numSamples);
+        return;
+    }
+
+    auto numShared = juce::jmin(numSourceChannels, numDestChannels);
+    for (int ch = 0; ch < numShared; ++ch)
+        dest.copyFrom(ch, 0, source, ch, 0, numSamples);
+
+    for (int ch = numShared; ch < numDestChannels; ++ch)
+        dest.clear(ch, 0, numSamples);
+
+    if (numSourceChannels <= numDestChannels)
+        return;
+
+    // 5.1 (L R C LFE Ls Rs) -> stereo
+    if (numSourceChannels == 6 && numDestChannels == 2)
+    {
+        dest.addFrom(0, 0, source, 2, 0, numSamples, minus3dB);
+        dest.addFrom(1, 0, source, 2, 0, numSamples, minus3dB);
+        dest.addFrom(0, 0, source, 4, 0, numSamples, minus3dB);
+        dest.addFrom(1, 0, source, 5, 0, numSamples, minus3dB);
+        return;
+    }
+
+    // Anything else: fold the extra channels into both L and R
+    for (int ch = numDestChannels; ch < numSourceChannels; ++ch)
+    {
+        dest.addFrom(0, 0, source, ch, 0, numSamples, minus6dB);
+        dest.addFrom(1, 0, source, ch, 0, numSamples, minus6dB);
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// ===============================================================================================================
+// Maps the host's bus layout onto whatever layout the hosted plugin has, using scratch channels that are
+// allocated once in prepare(). process() never allocates, so a 1-in/2-out or 5.1 plugin costs the same
+// steady-state allocations as a stereo one (none).
+//
+// Mixing rules (applied on the way in and again on the way out):
+//   same count -> straight copy
+//   N -> 1     -> average of all channels
+//   1 -> N     -> mono copied to the first two channels, the rest silent
+//   5.1 -> 2   -> ITU downmix, L/R + -3 dB centre + -3 dB surrounds, LFE dropped
+//   M -> N<M   -> first N copied, the extra channels folded into L and R at -6 dB
+//   M -> N>M   -> first M copied, the rest silent
+class ChannelAdapter
+{
+public:
+    enum
+    {
+        maxPluginChannels = 16     // largest plugin layout we keep scratch space for
+    };
+
+    ChannelAdapter() = default;
+
+    void prepare(int maximumBlockSize);
+    void releaseResources();
+
+    // Runs the plugin on hostBuffer, adapting channel counts in both directions when they differ
+    void process(juce::AudioProcessor& plugin, juce::AudioBuffer<float>& hostBuffer, juce::MidiBuffer& midi) noexcept;
+
+    static void mix(const juce::AudioBuffer<float>& source, int numSourceChannels,
+                    juce::AudioBuffer<float>& dest, int numDestChannels, int numSamples) noexcept;
+
+private:
+    juce::AudioBuffer<float> scratch;
+
+    JUCE_DECLARE_NON_COPYABLE(ChannelAdapter)
+};
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// ===============================================================================================================
+// Integer delay used for latency compensation. Storage is allocated in setDelay(), never while processing.
+// The line keeps room for delays up to its maximum, so the delay can move within it without allocating; moves
+// crossfade from the old tap to the new one instead of jumping.
+class LatencyDelay
+{
+public:
+    LatencyDelay() = default;
+
+    // Message thread / prepareToPlay. maximumDelay reserves room for later rampToDelay() calls.
+    void setDelay(int numChannels, int newDelayInSamples, int maximumDelay = 0)
+    {
+        delay = previousDelay = juce::jmax(0, newDelayInSamples);
+        capacity = juce::jmax(delay, maximumDelay) + 1;
+        ring.setSize(juce::jmax(1, numChannels), capacity);
+        ring.clear();
+        position = 0;
+        fadeLength = fadePosition = 0;
+    }
+
+    // Message thread, with the audio thread locked out, right before this line replaces previous. Takes over
+    // the history previous has seen and fades from its delay to ours, so the output carries on without a gap.
+    // setDelay() must have left room for previous's delay.
+    void continueFrom(const LatencyDelay& previous, int newFadeLength) noexcept
+    {
+        jassert(previous.delay < capacity);
+
+        auto count = juce::jmin(capacity, previous.capacity);
+        auto numCh = juce::jmin(ring.getNumChannels(), previous.ring.getNumChannels());
+        for (int ch = 0; ch < numCh; ++ch)
+        {
+            auto* line = ring.getWritePointer(ch);
+            auto* from = previous.ring.getReadPointer(ch);
+            for (int i = 0; i < count; ++i)
+                line[capacity - count + i] = from[(previous.position - count + i + previous.capacity) % previous.capacity];
+        }
+
+        position = 0;
+        previousDelay = juce::jmin(previous.delay, capacity - 1);
+        fadeLength = previousDelay != delay ? juce::jmax(1, newFadeLength) : 0;
+
+        // A longer delay reaches back past what previous kept: hold the old tap until the new one has real history
+        fadePosition = fadeLength > 0 ? -juce::jmax(0, delay - (count - 1)) : 0;
+    }
+
+    // Audio thread. Moves to newDelay, which must fit the maximum given to setDelay(), fading over fadeLength.
+    void rampToDelay(int newDelay, int newFadeLength) noexcept
+    {
+        jassert(newDelay < capacity);
+
+        previousDelay = delay;
+        delay = juce::jlimit(0, capacity - 1, newDelay);
+        fadeLength = previousDelay != delay ? juce::jmax(0, newFadeLength) : 0;
+        fadePosition = 0;
+        if (fadeLength == 0)
+            previousDelay = delay;
+    }
+
+    int getDelay() const noexcept { return delay; }
+    int getMaximumDelay() const noexcept { return capacity - 1; }
+    int getNumChannels() const noexcept { return ring.getNumChannels(); }
+    bool isRamping() const noexcept { return fadePosition < fadeLength; }
+
+    // Feed the line without reading from it, so it is primed if we switch to it later
+    void write(const juce::AudioBuffer<float>& source, int numSamples) noexcept
+    {
+        if (capacity <= 1)
+            return;
+
+        auto numCh = juce::jmin(source.getNumChannels(), ring.getNumChannels());
+        auto newPosition = position;
+        for (int ch = 0; ch < numCh; ++ch)
+        {
+            auto* line = ring.getWritePointer(ch);
+            auto* in = source.getReadPointer(ch);
+            newPosition = position;
+            for (int n = 0; n < numSamples; ++n)
+            {
+                line[newPosition] = in[n];
+                if (++newPosition == capacity)
+                    newPosition = 0;
+            }
+        }
+        position = newPosition;
+        fadePosition = juce::jmin(fadeLength, fadePosition + numSamples);
+    }
+
+    // Delays buffer in place
+    void process(juce::AudioBuffer<float>& buffer, int numSamples) noexcept
+    {
+        if (capacity <= 1)
+            return;
+
+        auto numCh = juce::jmin(buffer.getNumChannels(), ring.getNumChannels());
+        auto newPosition = position;
+        auto newFadePosition = fadePosition;
+        for (int ch = 0; ch < numCh; ++ch)
+        {
+            auto* line = ring.getWritePointer(ch);
+            auto* data = buffer.getWritePointer(ch);
+            newPosition = position;
+            newFadePosition = fadePosition;
+            for (int n = 0; n < numSamples; ++n)
+            {
+                line[newPosition] = data[n];
+                auto out = line[tap(newPosition, delay)];
+
+                if (newFadePosition < fadeLength)
+                {
+                    auto from = line[tap(newPosition, previousDelay)];
+                    auto gain = newFadePosition < 0 ? 0.0f : (float)(newFadePosition + 1) / (float)fadeLength;
+                    out = from + (out - from) * gain;
+                    ++newFadePosition;
+                }
+
+                data[n] = out;
+                if (++newPosition == capacity)
+                    newPosition = 0;
+            }
+        }
+        position = newPosition;
+        fadePosition = numCh > 0 ? newFadePosition : juce::jmin(fadeLength, fadePosition + numSamples);
+    }
+
+private:
+    int tap(int writePosition, int samplesAgo) const noexcept
+    {
+        auto index = writePosition - samplesAgo;
+        return index < 0 ? index + capacity : index;
+    }
+
+    juce::AudioBuffer<float> ring;
+    int capacity = 1;
+    int delay = 0;
+    int previousDelay = 0;  // where a fade started from
+    int position = 0;       // next write
+    int fadeLength = 0;
+    int fadePosition = 0;
+
+    JUCE_DECLARE_NON_COPYABLE(LatencyDelay)
+};
@@ -0,0 +1,450 @@
+#include "PluginChain.h"
+
+PluginChain::PluginChain(const juce::CriticalSection& callbackLockToUse)
+    : callbackLock(callbackLockToUse),
+      nodes(new Node[maxNodes])
+{
+}
+
+PluginChain::~PluginChain()
+{
+    for (int i = 0; i < maxNodes; ++i)
+    {
+        auto& node = nodes[i];
+        delete node.incoming.exchange(nullptr);
+        delete node.outgoing;
+        delete node.active;
+    }
+
+    while (auto plugin = popRetiredPlugin())
+        plugin.reset();
+}
+
+void PluginChain::prepare(double newSampleRate, int newMaximumBlockSize, int newNumChannels)
+{
+    const juce::ScopedLock wl(writerLock);
+
+    sampleRate = newSampleRate;
+    maximumBlockSize = newMaximumBlockSize;
+    numChannels = juce::jmax(1, newNumChannels);
+    crossfadeLength = juce::jmax(1, juce::roundToInt(sampleRate * crossfadeMs * 0.001));
+
+    interNode.setSize(numChannels, juce::jmax(1, maximumBlockSize));
+    fadeBuffer.setSize(numChannels, juce::jmax(1, maximumBlockSize));
+    fadeMidi.ensureSize(midiBufferBytes);
+
+    // The audio callback is stopped while the host re-prepares us, so the audio thread's fields are ours
+    for (int i = 0; i < numNodes.load(); ++i)
+    {
+        auto& node = nodes[i];
+        node.adapter.prepare(maximumBlockSize);
+
+        if (node.outgoing != nullptr)
+        {
+            orphan(node.outgoing);
+            node.outgoing = nullptr;
+        }
+
+        node.slidingNew = false;
+
+        if (node.active != nullptr)
+            prepareSlot(*node.active);
+
+        if (auto* next = node.incoming.load())
+            prepareSlot(*next);
+
+        node.wetPosition = node.bypassed.load() ? 0 : crossfadeLength;
+    }
+}
+
+void PluginChain::releaseResources()
+{
+    const juce::ScopedLock wl(writerLock);
+
+    for (int i = 0; i < numNodes.load(); ++i)
+    {
+        auto& node = nodes[i];
+        if (node.active != nullptr)
+            node.active->plugin->releaseResources();
+        node.adapter.releaseResources();
+    }
+}
+
+PluginChain::Slot* PluginChain::makeSlot(std::unique_ptr<juce::AudioPluginInstance> plugin, bool isPrepared)
+{
+    auto slot = std::make_unique<Slot>();
+    slot->plugin = std::move(plugin);
+    prepareSlot(*slot, isPrepared);
+    return slot.release();
+}
+
+void PluginChain::prepareSlot(Slot& slot, bool isPrepared)
+{
+    if (sampleRate <= 0.0)
+        return; // prepare() will get to it
+
+    // Prepared elsewhere, but the host may have changed the settings since
+    if (!isPrepared || slot.plugin->getSampleRate() != sampleRate || slot.plugin->getBlockSize() != maximumBlockSize)
+    {
+        slot.plugin->setRateAndBufferSizeDetails(sampleRate, maximumBlockSize);
+        slot.plugin->prepareToPlay(sampleRate, maximumBlockSize);
+    }
+
+    slot.latency = juce::jmax(0, slot.plugin->getLatencySamples());
+    slot.dryDelay.setDelay(numChannels, slot.latency);
+    slot.alignDelay.setDelay(numChannels, 0, slot.alignDelay.getMaximumDelay());
+}
+
+void PluginChain::orphan(Slot* slot)
+{
+    if (slot == nullptr)
+        return;
+
+    const juce::ScopedLock sl(orphanLock);
+    orphans.add(slot);
+}
+
+// =============================
+// Any thread except the audio thread
+// =============================
+bool PluginChain::appendPlugin(std::unique_ptr<juce::AudioPluginInstance> plugin, bool isPrepared)
+{
+    jassert(plugin != nullptr);
+
+    const juce::ScopedLock wl(writerLock);
+
+    auto index = numNodes.load();
+    if (index >= maxNodes)
+        return false;
+
+    // Everything that allocates or talks to the plugin happens before the audio thread can see the node
+    auto* slot = makeSlot(std::move(plugin), isPrepared);
+
+    auto& node = nodes[index];
+    node.adapter.prepare(juce::jmax(1, maximumBlockSize));
+    node.active = slot;
+    node.outgoing = nullptr;
+    node.fadePosition = 0;
+    node.slidingNew = false;
+    node.bypassed.store(false);
+    node.wetPosition = crossfadeLength;
+    node.published.store(slot);
+
+    numNodes.store(index + 1, std::memory_order_release);
+    return true;
+}
+
+bool PluginChain::replacePlugin(int index, std::unique_ptr<juce::AudioPluginInstance> plugin, bool isPrepared)
+{
+    jassert(plugin != nullptr);
+
+    const juce::ScopedLock wl(writerLock);
+
+    if (!juce::isPositiveAndBelow(index, numNodes.load()))
+        return false;
+
+    auto* slot = makeSlot(std::move(plugin), isPrepared);
+
+    auto& node = nodes[index];
+
+    // Room to delay whichever of old and new comes out earlier while they crossfade
+    if (auto* current = node.published.load())
+        slot->alignDelay.setDelay(numChannels, 0, juce::jmax(slot->latency, current->latency));
+
+    node.published.store(slot);
+
+    // A swap the audio thread hasn't picked up yet is simply superseded
+    orphan(node.incoming.exchange(slot, std::memory_order_acq_rel));
+    return true;
+}
+
+// =============================
+// Message thread
+// =============================
+std::unique_ptr<juce::AudioPluginInstance> PluginChain::removePlugin(int index)
+{
+    const juce::ScopedLock wl(writerLock);
+
+    Slot* removed = nullptr;
+    {
+        const juce::ScopedLock sl(callbackLock);
+
+        auto n = numNodes.load();
+        if (!juce::isPositiveAndBelow(index, n))
+            return {};
+
+        auto& node = nodes[index];
+        removed = node.active;
+        orphan(node.outgoing);
+        orphan(node.incoming.exchange(nullptr));
+
+        // Shift the later nodes down. Their adapters are interchangeable, so they stay where they are.
+        for (int i = index; i < n - 1; ++i)
+        {
+            auto& to = nodes[i];
+            auto& from = nodes[i + 1];
+            to.active = from.active;
+            to.outgoing = from.outgoing;
+            to.fadePosition = from.fadePosition;
+            to.swapStage = from.swapStage;
+            to.alignment = from.alignment;
+            to.slidingNew = from.slidingNew;
+            to.wetPosition = from.wetPosition;
+            to.bypassed.store(from.bypassed.load());
+            to.incoming.store(from.incoming.exchange(nullptr));
+            to.published.store(from.published.load());
+        }
+
+        auto& last = nodes[n - 1];
+        last.active = last.outgoing = nullptr;
+        last.published.store(nullptr);
+        numNodes.store(n - 1, std::memory_order_release);
+    }
+
+    if (removed == nullptr)
+        return {};
+
+    std::unique_ptr<Slot> slot(removed);
+    slot->plugin->releaseResources();
+    return std::move(slot->plugin);
+}
+
+std::unique_ptr<juce::AudioPluginInstance> PluginChain::popRetiredPlugin()
+{
+    std::unique_ptr<Slot> slot;
+
+    {
+        const juce::ScopedLock sl(orphanLock);
+        if (!orphans.isEmpty())
+            slot.reset(orphans.removeAndReturn(orphans.size() - 1));
+    }
+
+    if (slot == nullptr && retiredFifo.getNumReady() > 0)
+    {
+        int start1, size1, start2, size2;
+        retiredFifo.prepareToRead(1, start1, size1, start2, size2);
+        slot.reset(retired[start1]);
+        retiredFifo.finishedRead(size1);
+    }
+
+    if (slot == nullptr)
+        return {};
+
+    slot->plugin->releaseResources();
+    return std::move(slot->plugin);
+}
+
+void PluginChain::setBypassed(int index, bool shouldBeBypassed)
+{
+    if (juce::isPositiveAndBelow(index, size()))
+        nodes[index].bypassed.store(shouldBeBypassed);
+}
+
+bool PluginChain::isBypassed(int index) const
+{
+    if (juce::isPositiveAndBelow(index, size()))
+        return nodes[index].bypassed.load();
+    return false;
+}
+
+juce::AudioPluginInstance* PluginChain::getPlugin(int index) const noexcept
+{
+    if (juce::isPositiveAndBelow(index, size()))
+        if (auto* slot = nodes[index].published.load())
+            return slot->plugin.get();
+    return nullptr;
+}
+
+juce::String PluginChain::getDescription() const
+{
+    juce::StringArray names;
+    for (int i = 0; i < size(); ++i)
+        if (auto* plugin = getPlugin(i))
+            names.add(plugin->getName());
+    return names.joinIntoString(" > ");
+}
+
+int PluginChain::getTotalLatency() const noexcept
+{
+    int total = 0;
+    for (int i = 0; i < size(); ++i)
+        if (auto* slot = nodes[i].published.load())
+            total += slot->latency;
+    return total;
+}
+
+// =============================
+// Audio thread
+// =============================
+void PluginChain::renderSlot(Node& node, Slot& slot, bool bypassed, juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midi) noexcept
+{
+    auto numSamples = buffer.getNumSamples();
+
+    if (bypassed)
+    {
+        slot.dryDelay.process(buffer, numSamples);
+        return;
+    }
+
+    // Keep the dry delay warm so a later bypass switch is seamless
+    slot.dryDelay.write(buffer, numSamples);
+    node.adapter.process(*slot.plugin, buffer, midi);
+}
+
+void PluginChain::renderNode(Node& node, juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midi) noexcept
+{
+    auto& slot = *node.active;
+    auto bypassed = node.bypassed.load();
+    auto target = bypassed ? 0 : crossfadeLength;
+
+    if (node.wetPosition == target)
+    {
+        renderSlot(node, slot, bypassed, buffer, midi);
+        return;
+    }
+
+    // Bypass changed: render both paths and crossfade over crossfadeLength, like a swap. Flipping it again
+    // mid-fade turns the ramp around from wherever it got to.
+    auto numSamples = buffer.getNumSamples();
+    auto numCh = juce::jmin(buffer.getNumChannels(), interNode.getNumChannels());
+    for (int ch = 0; ch < numCh; ++ch)
+        interNode.copyFrom(ch, 0, buffer, ch, 0, numSamples);
+
+    juce::AudioBuffer<float> dry(interNode.getArrayOfWritePointers(), numCh, numSamples);
+    slot.dryDelay.process(dry, numSamples);
+    node.adapter.process(*slot.plugin, buffer, midi);
+
+    auto fadeEnd = bypassed ? juce::jmax(0, node.wetPosition - numSamples)
+                            : juce::jmin(crossfadeLength, node.wetPosition + numSamples);
+    auto wetStart = (float)node.wetPosition / (float)crossfadeLength;
+    auto wetEnd = (float)fadeEnd / (float)crossfadeLength;
+
+    for (int ch = 0; ch < numCh; ++ch)
+    {
+        buffer.applyGainRamp(ch, 0, numSamples, wetStart, wetEnd);
+        buffer.addFromWithRamp(ch, 0, dry.getReadPointer(ch), numSamples, 1.0f - wetStart, 1.0f - wetEnd);
+    }
+
+    node.wetPosition = fadeEnd;
+}
+
+void PluginChain::process(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midi) noexcept
+{
+    auto numSamples = buffer.getNumSamples();
+    if (numSamples > interNode.getNumSamples())
+    {
+        jassertfalse; // host broke its maximum block size promise
+        return;
+    }
+
+    auto n = numNodes.load(std::memory_order_acquire);
+    for (int i = 0; i < n; ++i)
+    {
+        auto& node = nodes[i];
+
+        // Pick up a freshly published plugin, unless the previous swap is still fading
+        if (node.outgoing == nullptr)
+        {
+            if (auto* next = node.incoming.exchange(nullptr, std::memory_order_acq_rel))
+            {
+                node.outgoing = node.active;
+                node.active = next;
+                node.fadePosition = 0;
+                node.swapStage = SwapStage::warmUp;
+                node.slidingNew = false;
+
+                // Line the two outputs up if the slot was given room for the difference. A swap that superseded
+                // another one may have been sized against a different plugin; that one just crossfades.
+                auto shift = next->latency - (node.outgoing != nullptr ? node.outgoing->latency : 0);
+                node.alignment = std::abs(shift) <= next->alignDelay.getMaximumDelay() ? shift : 0;
+                next->alignDelay.rampToDelay(juce::jmax(0, -node.alignment), 0);
+            }
+        }
+
+        if (node.active == nullptr)
+            continue;
+
+        if (node.outgoing == nullptr)
+        {
+            renderNode(node, buffer, midi);
+
+            if (node.slidingNew)
+            {
+                node.active->alignDelay.process(buffer, numSamples);
+                node.slidingNew = node.active->alignDelay.isRamping();
+            }
+            continue;
+        }
+
+        // Swap in progress: the old plugin renders a copy of the input, and the earlier of the two outputs
+        // is delayed to meet the later one
+        auto numCh = juce::jmin(buffer.getNumChannels(), fadeBuffer.getNumChannels());
+        for (int ch = 0; ch < numCh; ++ch)
+            fadeBuffer.copyFrom(ch, 0, buffer, ch, 0, numSamples);
+
+        juce::AudioBuffer<float> old(fadeBuffer.getArrayOfWritePointers(), numCh, numSamples);
+        fadeMidi.clear();
+        renderSlot(node, *node.outgoing, node.wetPosition == 0, old, fadeMidi);
+        renderNode(node, buffer, midi);
+
+        auto& align = node.active->alignDelay;
+        if (node.alignment > 0)
+            align.process(old, numSamples);
+        else if (node.alignment < 0)
+            align.process(buffer, numSamples);
+
+        if (node.swapStage != SwapStage::crossfade)
+        {
+            // Only the old plugin is heard until the new one is warmed up and both line up
+            for (int ch = 0; ch < numCh; ++ch)
+                buffer.copyFrom(ch, 0, old, ch, 0, numSamples);
+
+            if (node.swapStage == SwapStage::warmUp)
+            {
+                // Real output from the new plugin, delayed for alignment, starts after the longer of the latencies
+                node.fadePosition += numSamples;
+                if (node.fadePosition >= node.active->latency - juce::jmin(0, node.alignment))
+                {
+                    node.fadePosition = 0;
+                    node.swapStage = node.alignment > 0 ? SwapStage::slideOld : SwapStage::crossfade;
+                    if (node.alignment > 0)
+                        align.rampToDelay(node.alignment, crossfadeLength);
+                }
+            }
+            else if (!align.isRamping())
+            {
+                node.swapStage = SwapStage::crossfade;
+            }
+            continue;
+        }
+
+        auto fadeEnd = juce::jmin(crossfadeLength, node.fadePosition + numSamples);
+        auto newStart = (float)node.fadePosition / (float)crossfadeLength;
+        auto newEnd = (float)fadeEnd / (float)crossfadeLength;
+
+        for (int ch = 0; ch < numCh; ++ch)
+        {
+            buffer.applyGainRamp(ch, 0, numSamples, newStart, newEnd);
+            buffer.addFromWithRamp(ch, 0, old.getReadPointer(ch), numSamples, 1.0f - newStart, 1.0f - newEnd);
+        }
+
+        node.fadePosition = fadeEnd;
+
+        // Hand the old slot to the message thread. If the queue is full it keeps running silently until there is room.
+        if (node.fadePosition >= crossfadeLength && retiredFifo.getFreeSpace() > 0)
+        {
+            int start1, size1, start2, size2;
+            retiredFifo.prepareToWrite(1, start1, size1, start2, size2);
+            retired[start1] = node.outgoing;
+            retiredFifo.finishedWrite(size1);
+            node.outgoing = nullptr;
+
+            // The new output was held back to meet the old one; let it move in to its own latency
+            if (node.alignment < 0)
+            {
+                align.rampToDelay(0, crossfadeLength);
+                node.slidingNew = true;
+            }
+        }
+    }
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "ChannelAdapter.h"
+#include "LatencyDelay.h"
+
+// ===============================================================================================================
+// Ordered list of hosted plugins processed in series on the host buffer.
+// Every node has its own ChannelAdapter and a latency-matched delay line, so bypassing a node keeps the
+// chain's total latency (reported through setLatencySamples by the owner) constant.
+//
+// Plugins are prepared on whichever thread hands them over, unless the PluginLoader already prepared them at
+// the chain's settings, and then published to the audio thread through atomic pointers: appending bumps the
+// node count, replacing swaps the node's slot and crossfades old and new over crossfadeMs, lined up in time
+// when their latencies differ. The audio thread never allocates, locks or deletes; the instances it lets go
+// of are queued and destroyed on the message thread through popRetiredPlugin().
+class PluginChain
+{
+public:
+    enum
+    {
+        maxNodes = 16,
+        crossfadeMs = 20,
+        maxMidiEvents = 1024        // per block, what every MIDI buffer on the audio path reserves room for
+    };
+
+    // Bytes for maxMidiEvents three byte messages: MidiBuffer stores each with its int32 time and uint16 size.
+    // Longer messages (SysEx) use up the same budget.
+    static constexpr int midiBufferBytes = maxMidiEvents * (int)(sizeof(juce::int32) + sizeof(juce::uint16) + 3);
+
+    explicit PluginChain(const juce::CriticalSection& callbackLockToUse);
+    ~PluginChain();
+
+    void prepare(double newSampleRate, int newMaximumBlockSize, int newNumChannels);
+    void releaseResources();
+
+    // =============================
+    // Any thread except the audio thread
+    // =============================
+    // Prepares the plugin on the calling thread and publishes it at the end of the chain.
+    // Returns false and destroys the plugin if the chain is full.
+    bool appendPlugin(std::unique_ptr<juce::AudioPluginInstance> plugin, bool isPrepared = false);
+    // Prepares the plugin on the calling thread and crossfades to it from whatever node `index` is running.
+    // Returns false and destroys the plugin if there is no such node.
+    bool replacePlugin(int index, std::unique_ptr<juce::AudioPluginInstance> plugin, bool isPrepared = false);
+    // isPrepared: prepareToPlay was already called at the chain's sample rate and block size, skip it
+
+    // =============================
+    // Message thread
+    // =============================
+    // Structural removal, briefly takes the callback lock
+    std::unique_ptr<juce::AudioPluginInstance> removePlugin(int index);
+    // Instances the chain no longer uses. Destroy them on the message thread.
+    std::unique_ptr<juce::AudioPluginInstance> popRetiredPlugin();
+
+    void setBypassed(int index, bool shouldBeBypassed);
+    bool isBypassed(int index) const;
+
+    int size() const noexcept { return numNodes.load(std::memory_order_acquire); }
+    juce::AudioPluginInstance* getPlugin(int index) const noexcept;
+    juce::AudioPluginInstance* getLastPlugin() const noexcept { return getPlugin(size() - 1); }
+    juce::String getDescription() const; // "EQ > Compressor > Limiter"
+
+    // Sum of every node's latency, bypassed nodes included
+    int getTotalLatency() const noexcept;
+
+    // =============================
+    // Audio thread
+    // =============================
+    void process(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midi) noexcept;
+
+private:
+    // One prepared plugin plus the dry delay matching its latency, swapped as a unit
+    struct Slot
+    {
+        std::unique_ptr<juce::AudioPluginInstance> plugin;
+        int latency = 0;
+        LatencyDelay dryDelay;
+        LatencyDelay alignDelay;                   // delays the earlier of old and new while swapping to this slot
+    };
+
+    enum class SwapStage
+    {
+        warmUp,                                    // new plugin runs unheard until its output is real signal
+        slideOld,                                  // old output moves out to the new, longer latency
+        crossfade
+    };
+
+    struct Node
+    {
+        std::atomic<Slot*> published{ nullptr };   // newest slot handed over, what the other threads see
+        std::atomic<Slot*> incoming{ nullptr };    // waiting to be picked up by the audio thread
+
+        // Audio thread only
+        Slot* active = nullptr;
+        Slot* outgoing = nullptr;                  // previous slot while it is being faded out
+        int fadePosition = 0;
+        SwapStage swapStage = SwapStage::crossfade;
+        int alignment = 0;                         // new latency minus old, when alignDelay has room for it
+        bool slidingNew = false;                   // after a swap, new output moving in to its shorter latency
+        int wetPosition = 0;                       // bypass crossfade, 0 dry .. crossfadeLength through the plugin
+
+        std::atomic<bool> bypassed{ false };
+        ChannelAdapter adapter;
+    };
+
+    Slot* makeSlot(std::unique_ptr<juce::AudioPluginInstance> plugin, bool isPrepared);
+    void prepareSlot(Slot& slot, bool isPrepared = false);
+    void orphan(Slot* slot);
+    void renderSlot(Node& node, Slot& slot, bool bypassed, juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midi) noexcept;
+    void renderNode(Node& node, juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midi) noexcept;
+
+    const juce::CriticalSection& callbackLock;
+    juce::CriticalSection writerLock;          // serialises the non-audio threads that add or swap plugins
+
+    std::unique_ptr<Node[]> nodes;
+    std::atomic<int> numNodes{ 0 };
+
+    double sampleRate = 0.0;
+    int maximumBlockSize = 0;
+    int numChannels = 2;
+    int crossfadeLength = 1;
+
+    juce::AudioBuffer<float> interNode;        // dry copy of a node's input while its bypass is crossfading
+    juce::AudioBuffer<float> fadeBuffer;       // input copy for the outgoing plugin during a swap
+    juce::MidiBuffer fadeMidi;
+
+    // Audio thread -> message thread
+    juce::AbstractFifo retiredFifo{ maxNodes * 2 };
+    Slot* retired[maxNodes * 2] = {};
+
+    // Slots that never reached the audio thread
+    juce::CriticalSection orphanLock;
+    juce::Array<Slot*> orphans;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PluginChain)
+};
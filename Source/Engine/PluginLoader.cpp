@@ -0,0 +1,114 @@
+#include "PluginLoader.h"
+#include "../PluginProcessor.h"
+
+PluginLoader::PluginLoader(ChainBuilderAudioProcessor& processorRef)
+    : juce::Thread("Probe Plugin Loader"),
+      processor(processorRef)
+{
+    formatManager.addDefaultFormats();
+    startTimerHz(10);
+}
+
+PluginLoader::~PluginLoader()
+{
+    stopTimer();
+    stopThread(4000);
+    cancelPendingUpdate();
+}
+
+// =============================
+// Message thread
+// =============================
+void PluginLoader::loadPlugin(const juce::PluginDescription& description, int branchIndex, int nodeIndex, Callback onFinished)
+{
+    {
+        const juce::ScopedLock sl(lock);
+        requests.push_back({ description, branchIndex, nodeIndex, std::move(onFinished) });
+    }
+
+    if (!isThreadRunning())
+        startThread(juce::Thread::Priority::low);
+
+    notify();
+}
+
+void PluginLoader::handleAsyncUpdate()
+{
+    std::vector<Result> finished;
+    {
+        const juce::ScopedLock sl(lock);
+        finished.swap(results);
+    }
+
+    for (auto& result : finished)
+    {
+        auto outcome = juce::Result::fail(result.error.isNotEmpty() ? result.error : "The plugin could not be created");
+
+        if (result.plugin != nullptr)
+            outcome = processor.addPluginToChain(std::move(result.plugin), result.branchIndex, result.nodeIndex,
+                                                 result.isPrepared);
+
+        if (result.onFinished)
+            result.onFinished(outcome);
+    }
+}
+
+void PluginLoader::timerCallback()
+{
+    while (auto plugin = processor.rack.popRetiredPlugin())
+    {
+        if (onPluginRetired)
+            onPluginRetired(plugin.get());
+    }
+}
+
+// =============================
+// Loader thread
+// =============================
+void PluginLoader::run()
+{
+    while (!threadShouldExit())
+    {
+        Request request;
+        bool hasRequest = false;
+        {
+            const juce::ScopedLock sl(lock);
+            if (!requests.empty())
+            {
+                request = std::move(requests.front());
+                requests.erase(requests.begin());
+                hasRequest = true;
+            }
+        }
+
+        if (!hasRequest)
+        {
+            wait(-1);
+            continue;
+        }
+
+        auto sampleRate = processor.getSampleRate() > 0.0 ? processor.getSampleRate() : 44100.0;
+        auto blockSize = processor.getBlockSize() > 0 ? processor.getBlockSize() : 512;
+
+        Result result;
+        result.branchIndex = request.branchIndex;
+        result.nodeIndex = request.nodeIndex;
+        result.onFinished = std::move(request.onFinished);
+        result.plugin = formatManager.createPluginInstance(request.description, sampleRate, blockSize, result.error);
+
+        // The slow part, so the message thread only has to insert it. Not prepared yet means the chain will.
+        if (result.plugin != nullptr && processor.getSampleRate() > 0.0)
+        {
+            result.plugin->setRateAndBufferSizeDetails(sampleRate, blockSize);
+            result.plugin->prepareToPlay(sampleRate, blockSize);
+            result.isPrepared = true;
+        }
+
+        {
+            const juce::ScopedLock sl(lock);
+            results.push_back(std::move(result));
+        }
+
+        triggerAsyncUpdate();
+    }
+}
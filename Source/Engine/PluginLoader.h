@@ -0,0 +1,61 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+class ChainBuilderAudioProcessor;
+
+// ===============================================================================================================
+// Creates and prepares hosted plugins on a background thread, then hands them to the message thread, which
+// is the only one that changes the rack. Instantiating and preparing a plugin can take seconds and the audio
+// thread never waits for it: the running chain keeps playing, crossfading to the new instance once it's ready.
+// createPluginInstance does marshal onto the message thread for formats that must be created there (VST3, AU),
+// so those block the UI for as long as their constructor takes; prepareToPlay still runs here.
+//
+// A timer on the message thread destroys the instances the chains let go of.
+class PluginLoader : private juce::Thread, private juce::AsyncUpdater, private juce::Timer
+{
+public:
+    // Called on the message thread once the plugin is in the rack, or with the reason it isn't
+    using Callback = std::function<void(const juce::Result& result)>;
+
+    explicit PluginLoader(ChainBuilderAudioProcessor& processorRef);
+    ~PluginLoader() override;
+
+    // Message thread. nodeIndex < 0 appends to the branch, branchIndex == rack size starts a new branch.
+    void loadPlugin(const juce::PluginDescription& description, int branchIndex, int nodeIndex, Callback onFinished);
+
+    // Message thread, called right before a retired instance is destroyed so editors and listeners can let go of it
+    std::function<void(juce::AudioPluginInstance*)> onPluginRetired;
+
+private:
+    struct Request
+    {
+        juce::PluginDescription description;
+        int branchIndex = 0;
+        int nodeIndex = -1;
+        Callback onFinished;
+    };
+
+    struct Result
+    {
+        std::unique_ptr<juce::AudioPluginInstance> plugin;   // nullptr if creation failed
+        bool isPrepared = false;
+        juce::String error;
+        int branchIndex = 0;
+        int nodeIndex = -1;
+        Callback onFinished;
+    };
+
+    void run() override;
+    void handleAsyncUpdate() override;
+    void timerCallback() override;
+
+    ChainBuilderAudioProcessor& processor;
+    juce::AudioPluginFormatManager formatManager;
+
+    juce::CriticalSection lock;
+    std::vector<Request> requests;
+    std::vector<Result> results;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PluginLoader)
+};
@@ -0,0 +1,264 @@
+#include "RenderThreadPool.h"
+
+#if JUCE_WINDOWS
+ #include <windows.h>
+#elif JUCE_MAC || JUCE_IOS
+ #include <dispatch/dispatch.h>
+#else
+ #include <semaphore.h>
+#endif
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+#endif
+
+namespace
+{
+    constexpr uint32_t closedIndex = 0xffffffffu;
+
+    // Tells the core we are spinning, so a hyperthread sibling gets the pipeline meanwhile
+    inline void spinPause() noexcept
+    {
+       #if JUCE_INTEL
+        _mm_pause();
+       #elif JUCE_ARM && ! JUCE_MSVC
+        __asm__ __volatile__ ("yield");
+       #else
+        std::this_thread::yield();
+       #endif
+    }
+}
+
+// =============================
+// WakeSemaphore
+// =============================
+RenderThreadPool::WakeSemaphore::WakeSemaphore()
+{
+   #if JUCE_WINDOWS
+    handle = CreateSemaphoreW(nullptr, 0, 0x7fffffff, nullptr);
+   #elif JUCE_MAC || JUCE_IOS
+    handle = dispatch_semaphore_create(0);
+   #else
+    auto* semaphore = new sem_t;
+    sem_init(semaphore, 0, 0);
+    handle = semaphore;
+   #endif
+}
+
+RenderThreadPool::WakeSemaphore::~WakeSemaphore()
+{
+   #if JUCE_WINDOWS
+    CloseHandle((HANDLE)handle);
+   #elif JUCE_MAC || JUCE_IOS
+    dispatch_release((dispatch_semaphore_t)handle);
+   #else
+    sem_destroy((sem_t*)handle);
+    delete (sem_t*)handle;
+   #endif
+}
+
+void RenderThreadPool::WakeSemaphore::signal() noexcept
+{
+    if (count.fetch_add(1, std::memory_order_acq_rel) >= 0)
+        return;
+
+   #if JUCE_WINDOWS
+    ReleaseSemaphore((HANDLE)handle, 1, nullptr);
+   #elif JUCE_MAC || JUCE_IOS
+    dispatch_semaphore_signal((dispatch_semaphore_t)handle);
+   #else
+    sem_post((sem_t*)handle);
+   #endif
+}
+
+void RenderThreadPool::WakeSemaphore::wait() noexcept
+{
+    // Blocks usually follow each other closely, so spin briefly before going to sleep
+    for (int spin = 0; spin < 256; ++spin)
+    {
+        auto current = count.load(std::memory_order_relaxed);
+        if (current > 0 && count.compare_exchange_weak(current, current - 1, std::memory_order_acq_rel))
+            return;
+
+        spinPause();
+    }
+
+    if (count.fetch_sub(1, std::memory_order_acq_rel) > 0)
+        return;
+
+   #if JUCE_WINDOWS
+    WaitForSingleObject((HANDLE)handle, INFINITE);
+   #elif JUCE_MAC || JUCE_IOS
+    dispatch_semaphore_wait((dispatch_semaphore_t)handle, DISPATCH_TIME_FOREVER);
+   #else
+    while (sem_wait((sem_t*)handle) != 0) {}
+   #endif
+}
+
+// =============================
+// Queue
+// =============================
+RenderThreadPool::Job* RenderThreadPool::Queue::pop(uint32_t expectedGeneration) noexcept
+{
+    auto s = state.load(std::memory_order_acquire);
+
+    for (;;)
+    {
+        if ((uint32_t)(s >> 32) != expectedGeneration)
+            return nullptr;
+
+        auto index = (uint32_t)s;
+        if (index == closedIndex || (int)index >= count.load(std::memory_order_acquire))
+            return nullptr;
+
+        auto* job = jobs[index].load(std::memory_order_acquire);
+        if (state.compare_exchange_weak(s, s + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+            return job;
+    }
+}
+
+// =============================
+// Worker
+// =============================
+RenderThreadPool::Worker::Worker(RenderThreadPool& poolRef, int queueIndexToUse)
+    : juce::Thread("Probe Render " + juce::String(queueIndexToUse)),
+      pool(poolRef),
+      queueIndex(queueIndexToUse)
+{
+}
+
+void RenderThreadPool::Worker::run()
+{
+    // Same FTZ/DAZ as the audio thread, or crossovers and plugins crawl through denormal tails here
+    juce::ScopedNoDenormals noDenormals;
+
+    auto seen = pool.generation.load(std::memory_order_acquire);
+
+    while (!threadShouldExit())
+    {
+        // stop() signals as well, so this never sleeps through an exit request
+        wakeUp.wait();
+
+        auto current = pool.generation.load(std::memory_order_acquire);
+        if (current == seen)
+            continue;
+
+        seen = current;
+        pool.runJobs(queueIndex, current);
+    }
+}
+
+// =============================
+// RenderThreadPool
+// =============================
+RenderThreadPool::RenderThreadPool(int numWorkersToUse)
+{
+    numQueues = juce::jlimit(0, (int)maxWorkers, numWorkersToUse) + 1;
+    queues.reset(new Queue[(size_t)numQueues]);
+
+    for (int i = 1; i < numQueues; ++i)
+        workers.add(new Worker(*this, i));
+}
+
+RenderThreadPool::~RenderThreadPool()
+{
+    stop();
+}
+
+void RenderThreadPool::start(double sampleRate, int blockSize)
+{
+    auto options = juce::Thread::RealtimeOptions{}.withApproximateAudioProcessingTime(juce::jmax(1, blockSize), sampleRate);
+
+    for (auto* worker : workers)
+        if (!worker->isThreadRunning())
+            worker->startRealtimeThread(options);
+}
+
+void RenderThreadPool::stop()
+{
+    for (auto* worker : workers)
+    {
+        worker->signalThreadShouldExit();
+        worker->wakeUp.signal();
+    }
+
+    for (auto* worker : workers)
+        worker->stopThread(500);
+}
+
+void RenderThreadPool::render(Job* const* jobs, int numJobs) noexcept
+{
+    if (numJobs <= 0)
+        return;
+
+    if (numJobs == 1 || workers.isEmpty())
+    {
+        for (int i = 0; i < numJobs; ++i)
+            jobs[i]->render();
+        return;
+    }
+
+    auto newGeneration = generation.load(std::memory_order_relaxed) + 1;
+    auto numUsedQueues = juce::jmin(numJobs, numQueues);
+
+    // Close every queue first, so a thread still spinning on the previous block can't claim a slot
+    // while it is being refilled
+    for (int q = 0; q < numQueues; ++q)
+        queues[q].state.store(((uint64_t)newGeneration << 32) | closedIndex, std::memory_order_release);
+
+    int counts[maxWorkers + 1] = {};
+    auto numQueued = juce::jmin(numJobs, numQueues * (int)maxJobsPerQueue);
+    for (int i = 0; i < numQueued; ++i)
+    {
+        auto q = i % numQueues;
+        queues[q].jobs[counts[q]++].store(jobs[i], std::memory_order_release);
+    }
+
+    numPending.store(numQueued, std::memory_order_relaxed);
+
+    for (int q = 0; q < numQueues; ++q)
+    {
+        queues[q].count.store(counts[q], std::memory_order_release);
+        queues[q].state.store((uint64_t)newGeneration << 32, std::memory_order_release);
+    }
+
+    generation.store(newGeneration, std::memory_order_release);
+
+    for (int q = 1; q < numUsedQueues; ++q)
+        workers.getUnchecked(q - 1)->wakeUp.signal();
+
+    // The audio thread works too, then steals, then waits for whatever is still running elsewhere
+    runJobs(0, newGeneration);
+
+    // More jobs than the queues can hold: should never happen with BranchRack::maxBranches
+    for (int i = numQueued; i < numJobs; ++i)
+        jobs[i]->render();
+
+    // runJobs() only returns once every queue is empty, so all that's left is jobs already running on a
+    // worker. Pause while they should finish any moment, yield if they run long.
+    for (int spin = 0; numPending.load(std::memory_order_acquire) > 0; ++spin)
+    {
+        if (spin < 1024)
+            spinPause();
+        else
+            std::this_thread::yield();
+    }
+}
+
+RenderThreadPool::Job* RenderThreadPool::takeJob(int ownQueue, uint32_t expectedGeneration) noexcept
+{
+    for (int i = 0; i < numQueues; ++i)
+        if (auto* job = queues[(ownQueue + i) % numQueues].pop(expectedGeneration))
+            return job;
+
+    return nullptr;
+}
+
+void RenderThreadPool::runJobs(int ownQueue, uint32_t expectedGeneration) noexcept
+{
+    while (auto* job = takeJob(ownQueue, expectedGeneration))
+    {
+        job->render();
+        numPending.fetch_sub(1, std::memory_order_acq_rel);
+    }
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// ===============================================================================================================
+// Fixed pool of real-time worker threads used to render parallel branches inside one audio callback.
+// render() deals the jobs round-robin onto one queue per thread (the calling audio thread owns queue 0),
+// wakes the workers, and everybody pops from their own queue first and then steals from the others until
+// no work is left. Nothing here allocates or takes a lock once start() has been called: waking a worker is an
+// atomic increment, plus one lock-free kernel call if that worker had gone to sleep.
+class RenderThreadPool
+{
+public:
+    struct Job
+    {
+        virtual ~Job() = default;
+        virtual void render() noexcept = 0;
+    };
+
+    enum
+    {
+        maxWorkers = 31,
+        maxJobsPerQueue = 32
+    };
+
+    explicit RenderThreadPool(int numWorkersToUse);
+    ~RenderThreadPool();
+
+    // Starts the workers with real-time priority tuned for the given block duration
+    void start(double sampleRate, int blockSize);
+    void stop();
+
+    int getNumWorkers() const noexcept { return workers.size(); }
+
+    // Audio thread: runs every job and only returns once all of them have finished
+    void render(Job* const* jobs, int numJobs) noexcept;
+
+private:
+    // Counting semaphore in the style of a benaphore. signal() stays in user space unless a waiter is actually
+    // asleep, and then posts the platform semaphore (ReleaseSemaphore, dispatch_semaphore_signal, sem_post),
+    // none of which take a user-space mutex the way juce::WaitableEvent does.
+    class WakeSemaphore
+    {
+    public:
+        WakeSemaphore();
+        ~WakeSemaphore();
+
+        void signal() noexcept;
+        void wait() noexcept;
+
+    private:
+        std::atomic<int> count{ 0 };    // negative: that many waiters asleep on the platform semaphore
+        void* handle = nullptr;
+
+        JUCE_DECLARE_NON_COPYABLE(WakeSemaphore)
+    };
+
+    struct Queue
+    {
+        // Upper 32 bits: generation, lower 32 bits: index of the next job to take.
+        // Tagging with the generation stops a slow thread from claiming a job that belongs to an older block.
+        std::atomic<uint64_t> state{ 0 };
+        std::atomic<int> count{ 0 };
+        std::atomic<Job*> jobs[maxJobsPerQueue] = {};
+
+        Job* pop(uint32_t generation) noexcept;
+    };
+
+    class Worker : public juce::Thread
+    {
+    public:
+        Worker(RenderThreadPool& poolRef, int queueIndexToUse);
+        void run() override;
+
+        WakeSemaphore wakeUp;
+
+    private:
+        RenderThreadPool& pool;
+        int queueIndex;
+    };
+
+    Job* takeJob(int ownQueue, uint32_t generation) noexcept;
+    void runJobs(int ownQueue, uint32_t generation) noexcept;
+
+    juce::OwnedArray<Worker> workers;
+    std::unique_ptr<Queue[]> queues;     // workers.size() + 1, queue 0 belongs to the audio thread
+    int numQueues = 1;
+
+    std::atomic<uint32_t> generation{ 0 };
+    std::atomic<int> numPending{ 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(RenderThreadPool)
+};
@@ -0,0 +1,313 @@
+#include "StimulusGenerator.h"
+#include "../Metrics/IntermodulationMeter.h"
+
+namespace
+{
+    uint64_t splitMix64(uint64_t& x) noexcept
+    {
+        uint64_t z = (x += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    inline uint32_t rotl(uint32_t x, int k) noexcept
+    {
+        return (x << k) | (x >> (32 - k));
+    }
+}
+
+// =============================
+// Xoshiro8
+// =============================
+void StimulusGenerator::Xoshiro8::seed(uint64_t seedValue) noexcept
+{
+    uint64_t sm = seedValue;
+    for (int lane = 0; lane < numLanes; ++lane)
+    {
+        auto a = splitMix64(sm), b = splitMix64(sm);
+        s0[lane] = (uint32_t)a;
+        s1[lane] = (uint32_t)(a >> 32);
+        s2[lane] = (uint32_t)b;
+        s3[lane] = (uint32_t)(b >> 32) | 1u; // state must never be all zero
+    }
+}
+
+void StimulusGenerator::Xoshiro8::nextBipolar(float* dest) noexcept
+{
+    constexpr float scale = 2.0f / 16777216.0f; // top 24 bits -> [0, 2)
+
+    for (int lane = 0; lane < numLanes; ++lane)
+    {
+        auto result = s0[lane] + s3[lane];
+        auto t = s1[lane] << 9;
+
+        s2[lane] ^= s0[lane];
+        s3[lane] ^= s1[lane];
+        s1[lane] ^= s2[lane];
+        s0[lane] ^= s3[lane];
+        s2[lane] ^= t;
+        s3[lane] = rotl(s3[lane], 11);
+
+        dest[lane] = (float)(result >> 8) * scale - 1.0f;
+    }
+}
+
+// =============================
+// StimulusGenerator
+// =============================
+void StimulusGenerator::prepare(double newSampleRate, int numChannels)
+{
+    sampleRate = newSampleRate;
+    channels.resize((size_t)juce::jmax(1, numChannels));
+
+    tableLength = periodicTableLength;
+    buildMultitoneTable();
+
+    sweepLength = getSweepLength(sampleRate);
+    sweepTable.allocate((size_t)sweepLength, false);
+    fillSweep(sweepTable.get(), sampleRate);
+
+    // Bins shared with IntermodulationMeter, so every product it looks for lands on a bin as well
+    auto smpte = IntermodulationMeter::getTones(IntermodulationMeter::Standard::smpte, sampleRate, tableLength);
+    auto ccif = IntermodulationMeter::getTones(IntermodulationMeter::Standard::ccif, sampleRate, tableLength);
+    buildTwoToneTable(smpteTable, smpte.lowBin, smpte.lowGain, smpte.highBin, smpte.highGain);
+    buildTwoToneTable(ccifTable, ccif.lowBin, ccif.lowGain, ccif.highBin, ccif.highGain);
+
+    reset();
+}
+
+void StimulusGenerator::reset()
+{
+    currentType = getType();
+
+    // Fixed seed per channel: the same run always produces the same noise
+    for (size_t ch = 0; ch < channels.size(); ++ch)
+    {
+        auto& state = channels[ch];
+        state.rng.seed(defaultSeed + 0x1000193ull * (uint64_t)ch);
+        state.cacheIndex = Xoshiro8::numLanes;
+        std::fill(std::begin(state.pink), std::end(state.pink), 0.0f);
+    }
+
+    sweepPosition = 0;
+
+    impulsePeriod = (int64_t)(impulseSeconds * sampleRate);
+    impulsePosition = 0;
+
+    tablePosition = 0;
+    sinePhase = 0.0;
+}
+
+int StimulusGenerator::getSweepLength(double sampleRate) noexcept
+{
+    return juce::nextPowerOfTwo((int)(sweepSeconds * sampleRate));
+}
+
+void StimulusGenerator::fillSweep(float* dest, double sampleRate) noexcept
+{
+    // Farina: phase(n) = w1 L (e^(n / L) - 1), so the frequency rises from w1 by a factor e every L samples
+    auto length = getSweepLength(sampleRate);
+    auto startOmega = juce::MathConstants<double>::twoPi * sweepStartHz / sampleRate;
+    auto rate = (double)length / std::log(getSweepEndHz(sampleRate) / sweepStartHz);
+
+    for (int n = 0; n < length; ++n)
+        dest[n] = (float)std::sin(startOmega * rate * (std::exp(n / rate) - 1.0));
+}
+
+juce::StringArray StimulusGenerator::getTypeNames()
+{
+    return { "Live Input", "White Noise", "Pink Noise", "Log Sweep", "Impulse Train", "Multitone", "Sine",
+             "SMPTE Two-Tone", "CCIF Two-Tone" };
+}
+
+void StimulusGenerator::render(juce::AudioBuffer<float>& buffer) noexcept
+{
+    if (getType() != currentType)
+        reset();
+
+    auto numSamples = buffer.getNumSamples();
+    auto numChannels = juce::jmin(buffer.getNumChannels(), (int)channels.size());
+    auto gain = level.load();
+
+    switch (currentType)
+    {
+        case Type::whiteNoise:
+            for (int ch = 0; ch < numChannels; ++ch)
+                renderWhite(channels[(size_t)ch], buffer.getWritePointer(ch), numSamples);
+            break;
+
+        case Type::pinkNoise:
+            for (int ch = 0; ch < numChannels; ++ch)
+                renderPink(channels[(size_t)ch], buffer.getWritePointer(ch), numSamples);
+            break;
+
+        case Type::logSweep:
+            renderSweep(buffer.getWritePointer(0), numSamples);
+            break;
+
+        case Type::impulseTrain:
+        {
+            auto* dest = buffer.getWritePointer(0);
+            juce::FloatVectorOperations::clear(dest, numSamples);
+            for (int n = 0; n < numSamples; ++n)
+            {
+                if (impulsePosition == 0)
+                    dest[n] = 1.0f;
+
+                if (++impulsePosition >= impulsePeriod)
+                    impulsePosition = 0;
+            }
+            break;
+        }
+
+        case Type::multitone:
+            renderTable(multitoneTable, buffer.getWritePointer(0), numSamples);
+            break;
+
+        case Type::smpteTwoTone:
+            renderTable(smpteTable, buffer.getWritePointer(0), numSamples);
+            break;
+
+        case Type::ccifTwoTone:
+            renderTable(ccifTable, buffer.getWritePointer(0), numSamples);
+            break;
+
+        case Type::sine:
+        {
+            // Phase kept in double, a float accumulator would add its own distortion products
+            auto* dest = buffer.getWritePointer(0);
+            auto hz = juce::jlimit(1.0, sampleRate * 0.5, sineFrequency.load());
+            auto increment = juce::MathConstants<double>::twoPi * hz / sampleRate;
+            for (int n = 0; n < numSamples; ++n)
+            {
+                dest[n] = (float)std::sin(sinePhase);
+                sinePhase += increment;
+
+                if (sinePhase >= juce::MathConstants<double>::twoPi)
+                    sinePhase -= juce::MathConstants<double>::twoPi;
+            }
+            break;
+        }
+
+        case Type::live:
+        default:
+            return;
+    }
+
+    // Deterministic signals are identical on every channel
+    if (currentType != Type::whiteNoise && currentType != Type::pinkNoise)
+        for (int ch = 1; ch < buffer.getNumChannels(); ++ch)
+            buffer.copyFrom(ch, 0, buffer, 0, 0, numSamples);
+
+    if (gain != 1.0f)
+        buffer.applyGain(gain);
+}
+
+void StimulusGenerator::renderTable(const float* table, float* dest, int numSamples) noexcept
+{
+    for (int n = 0; n < numSamples;)
+    {
+        auto numToCopy = juce::jmin(numSamples - n, tableLength - tablePosition);
+        juce::FloatVectorOperations::copy(dest + n, table + tablePosition, numToCopy);
+        n += numToCopy;
+        tablePosition = (tablePosition + numToCopy) % tableLength;
+    }
+}
+
+void StimulusGenerator::renderSweep(float* dest, int numSamples) noexcept
+{
+    for (int n = 0; n < numSamples;)
+    {
+        auto numToCopy = juce::jmin(numSamples - n, sweepLength - sweepPosition);
+        juce::FloatVectorOperations::copy(dest + n, sweepTable + sweepPosition, numToCopy);
+        n += numToCopy;
+        sweepPosition = (sweepPosition + numToCopy) % sweepLength;
+    }
+}
+
+void StimulusGenerator::renderWhite(ChannelState& state, float* dest, int numSamples) noexcept
+{
+    constexpr int numLanes = Xoshiro8::numLanes;
+    int n = 0;
+
+    // Drain what's left from the previous block so the stream doesn't depend on the host block size
+    while (n < numSamples && state.cacheIndex < numLanes)
+        dest[n++] = state.cache[state.cacheIndex++];
+
+    for (; n + numLanes <= numSamples; n += numLanes)
+        state.rng.nextBipolar(dest + n);
+
+    if (n < numSamples)
+    {
+        state.rng.nextBipolar(state.cache);
+        state.cacheIndex = 0;
+        while (n < numSamples)
+            dest[n++] = state.cache[state.cacheIndex++];
+    }
+}
+
+void StimulusGenerator::renderPink(ChannelState& state, float* dest, int numSamples) noexcept
+{
+    renderWhite(state, dest, numSamples);
+
+    // Paul Kellet's refined pinking filter, accurate to +-0.05 dB above 9.2 Hz at 44.1 kHz
+    auto* b = state.pink;
+    for (int n = 0; n < numSamples; ++n)
+    {
+        auto white = dest[n];
+        b[0] = 0.99886f * b[0] + white * 0.0555179f;
+        b[1] = 0.99332f * b[1] + white * 0.0750759f;
+        b[2] = 0.96900f * b[2] + white * 0.1538520f;
+        b[3] = 0.86650f * b[3] + white * 0.3104856f;
+        b[4] = 0.55000f * b[4] + white * 0.5329522f;
+        b[5] = -0.7616f * b[5] - white * 0.0168980f;
+        dest[n] = (b[0] + b[1] + b[2] + b[3] + b[4] + b[5] + b[6] + white * 0.5362f) * 0.11f;
+        b[6] = white * 0.115926f;
+    }
+}
+
+void StimulusGenerator::buildMultitoneTable()
+{
+    // One analysis frame long with every tone on an exact bin, so the FFT sees it without leakage
+    multitoneTable.calloc((size_t)tableLength);
+
+    constexpr int numTones = 31;
+    auto nyquistBin = tableLength / 2 - 1;
+    auto firstBin = juce::jmax(1, (int)std::ceil(20.0 * tableLength / sampleRate));
+    auto lastBin = juce::jlimit(firstBin, nyquistBin, (int)(20000.0 * tableLength / sampleRate));
+
+    int previousBin = 0, toneIndex = 0;
+    for (int k = 0; k < numTones; ++k)
+    {
+        // Log spaced, rounded onto distinct bins
+        auto bin = (int)std::round(firstBin * std::pow((double)lastBin / firstBin, (double)k / (numTones - 1)));
+        if (bin <= previousBin)
+            continue;
+        previousBin = bin;
+
+        // Schroeder phases keep the crest factor low
+        auto phase = -juce::MathConstants<double>::pi * toneIndex * (toneIndex - 1) / numTones;
+        auto omega = juce::MathConstants<double>::twoPi * bin / tableLength;
+        for (int n = 0; n < tableLength; ++n)
+            multitoneTable[n] += (float)std::cos(omega * n + phase);
+        ++toneIndex;
+    }
+
+    auto peak = 0.0f;
+    for (int n = 0; n < tableLength; ++n)
+        peak = juce::jmax(peak, std::abs(multitoneTable[n]));
+
+    if (peak > 0.0f)
+        juce::FloatVectorOperations::multiply(multitoneTable.get(), 1.0f / peak, tableLength);
+}
+
+void StimulusGenerator::buildTwoToneTable(juce::HeapBlock<float>& table, int lowBin, float lowGain, int highBin, float highGain)
+{
+    auto lowOmega = juce::MathConstants<double>::twoPi * lowBin / tableLength;
+    auto highOmega = juce::MathConstants<double>::twoPi * highBin / tableLength;
+
+    table.calloc((size_t)tableLength);
+    for (int n = 0; n < tableLength; ++n)
+        table[n] = (float)(lowGain * std::sin(lowOmega * n) + highGain * std::sin(highOmega * n));
+}
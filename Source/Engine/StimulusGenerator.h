@@ -0,0 +1,118 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// ===============================================================================================================
+// Test signals that get pushed through the hosted plugin. Every channel owns its own seeded PRNG so a
+// measurement run is reproducible, and nothing here touches juce::Random's shared global generator.
+class StimulusGenerator
+{
+public:
+    enum class Type
+    {
+        live = 0,       // no stimulus, analyse whatever the DAW sends
+        whiteNoise,
+        pinkNoise,
+        logSweep,
+        impulseTrain,
+        multitone,
+        sine,           // distortion measurement, see DistortionMeter
+        smpteTwoTone,   // intermodulation, see IntermodulationMeter
+        ccifTwoTone
+    };
+
+    static constexpr uint64_t defaultSeed = 0x50524f4245ull; // "PROBE"
+
+    StimulusGenerator() = default;
+
+    void prepare(double newSampleRate, int numChannels);
+    void reset();
+
+    // Safe to call from any thread, picked up at the start of the next render()
+    void setType(Type newType) noexcept { requestedType.store((int)newType); }
+    Type getType() const noexcept { return (Type)requestedType.load(); }
+    bool isActive() const noexcept { return getType() != Type::live; }
+
+    void setLevel(float newGain) noexcept { level.store(newGain); }
+
+    // Any thread, the phase carries on so a change doesn't click
+    void setSineFrequency(double newHz) noexcept { sineFrequency.store(newHz); }
+    double getSineFrequency() const noexcept { return sineFrequency.load(); }
+
+    // Overwrites every channel of buffer with the current stimulus
+    void render(juce::AudioBuffer<float>& buffer) noexcept;
+
+    static juce::StringArray getTypeNames();
+
+    // Log sweep settings, also needed by anything that wants to rebuild the exact same sweep
+    static constexpr double sweepStartHz = 20.0;
+    static constexpr double sweepEndHz = 20000.0;
+    static constexpr double sweepSeconds = 5.0;
+
+    // The sweep repeats back to back with a period of sweepSeconds rounded up to a power of two samples, so
+    // SweepMeter can deconvolve one period with a single circular FFT
+    static int getSweepLength(double sampleRate) noexcept;
+    static double getSweepEndHz(double sampleRate) noexcept { return juce::jmin(sweepEndHz, sampleRate * 0.45); }
+
+    // One period of the exponential sweep, getSweepLength() samples
+    static void fillSweep(float* dest, double sampleRate) noexcept;
+
+    // Impulse spacing: long enough for most reverb tails to die away, DecayMeter captures exactly one period
+    static constexpr double impulseSeconds = 3.0;
+
+    // 997 Hz rather than 1 kHz (AES17): not a sub-multiple of common sample rates, so every cycle hits
+    // different sample phases
+    static constexpr double defaultSineHz = 997.0;
+
+    // Period of the multitone and two-tone tables. Fixed rather than following the analysis FFT size, so a
+    // size change doesn't restart the stimulus; every tone is on an exact bin of any analysis this long or longer.
+    enum { periodicTableLength = 4096 };
+
+private:
+    // xoshiro128+ running on 8 independent lanes, written as plain lane loops so the compiler keeps it in
+    // SIMD registers (one AVX or two SSE/NEON registers per state word)
+    struct Xoshiro8
+    {
+        enum { numLanes = 8 };
+
+        alignas(32) uint32_t s0[numLanes], s1[numLanes], s2[numLanes], s3[numLanes];
+
+        void seed(uint64_t seedValue) noexcept;
+        void nextBipolar(float* dest) noexcept; // fills numLanes floats in [-1, 1)
+    };
+
+    struct ChannelState
+    {
+        Xoshiro8 rng;
+        alignas(32) float cache[Xoshiro8::numLanes];
+        int cacheIndex = Xoshiro8::numLanes;     // numLanes means empty
+        float pink[7] = {};                      // Paul Kellet pinking filter state
+    };
+
+    void renderWhite(ChannelState& state, float* dest, int numSamples) noexcept;
+    void renderPink(ChannelState& state, float* dest, int numSamples) noexcept;
+    void buildMultitoneTable();
+    void buildTwoToneTable(juce::HeapBlock<float>& table, int lowBin, float lowGain, int highBin, float highGain);
+    void renderTable(const float* table, float* dest, int numSamples) noexcept;
+    void renderSweep(float* dest, int numSamples) noexcept;
+
+    double sampleRate = 44100.0;
+    std::vector<ChannelState> channels;
+
+    std::atomic<int> requestedType{ (int)Type::whiteNoise };
+    std::atomic<float> level{ 1.0f };
+    Type currentType = Type::whiteNoise;
+
+    // Deterministic signals
+    juce::HeapBlock<float> sweepTable;
+    int sweepPosition = 0, sweepLength = 1;
+    int64_t impulsePosition = 0, impulsePeriod = 44100;
+    double sinePhase = 0.0;
+    std::atomic<double> sineFrequency{ defaultSineHz };
+
+    // Periodic signals, periodicTableLength long with every tone on an exact bin
+    juce::HeapBlock<float> multitoneTable, smpteTable, ccifTable;
+    int tableLength = 0, tablePosition = 0;
+
+    JUCE_DECLARE_NON_COPYABLE(StimulusGenerator)
+};
@@ -77,7 +77,7 @@ void ChainBuilderAudioProcessorEditor::display_params(juce::Rectangle<int> bound
     float columnSpacing = 17.0f;
     int columns = 2;
 
-    if (audioProcessor.hostedPlugin != nullptr && dropZone->params_loaded)
+    if (audioProcessor.rack.getLastPlugin() != nullptr && dropZone->params_loaded)
     {
         if (chosen_parameters.size() != 0)
         {
@@ -122,6 +122,15 @@ void ChainBuilderAudioProcessorEditor::display_params(juce::Rectangle<int> bound
     }
 }
 
+void ChainBuilderAudioProcessorEditor::clearParameterDisplays()
+{
+    // The hosted plugin these parameters belong to is about to be destroyed
+    parameterDisplays.clear();
+    chosen_parameters.clear();
+    chosen_deltas.clear();
+    loaded_params = false;
+}
+
 void ChainBuilderAudioProcessorEditor::testParameterDisplayOffsets()
 {
     DBG("=== Testing ParameterDisplay Offsets ===");
@@ -153,14 +162,22 @@ void ChainBuilderAudioProcessorEditor::testParameterDisplayOffsets()
 }
 
 
+MetricSet ChainBuilderAudioProcessorEditor::getDisplayMetrics()
+{
+    return { MetricId::spectralCentroid, MetricId::spectralRolloff, MetricId::spectralFlatness,
+             MetricId::resonanceScore, MetricId::pitch };
+}
+
 void ChainBuilderAudioProcessorEditor::display_metrics()
 {
+    // One snapshot, so every line comes from the same analysis frame
+    auto& metrics = audioProcessor.analysisThread.readMetrics();
     juce::String metrics_display =
-        "Spectral Centroid: " + juce::String(audioProcessor.spectral_centroid, 2) + "\n"
-        "Spectral Rolloff: " + juce::String(audioProcessor.spectral_rolloff, 2) + "\n"
-        "Spectral Flatness: " + juce::String(audioProcessor.spectral_flatness, 2) + "\n"
-        "Resonance Score: " + juce::String(audioProcessor.resonance_score, 2) + "\n"
-        "Harmonic-to-Noise: " + juce::String(audioProcessor.harmonic_to_noise, 2);
+        "Spectral Centroid: " + juce::String(metrics.spectral_centroid, 2) + "\n"
+        "Spectral Rolloff: " + juce::String(metrics.spectral_rolloff, 2) + "\n"
+        "Spectral Flatness: " + juce::String(metrics.spectral_flatness, 2) + "\n"
+        "Resonance Score: " + juce::String(metrics.resonance_score, 2) + "\n"
+        "Harmonic-to-Noise: " + juce::String(metrics.harmonic_to_noise, 2) + " dB";
 
     auto area = getLocalBounds();
 
@@ -292,11 +309,13 @@ void ParameterDisplay::setTargetValue(float newTarget)
 
 PluginDropZone::PluginDropZone(ChainBuilderAudioProcessor& proc, ChainBuilderAudioProcessorEditor& editorRef)
     : audioProcessor(proc), hostEditor(editorRef) {
-    formatManager.addDefaultFormats(); // VST, AU, etc.
+    audioProcessor.pluginLoader.onPluginRetired = [this](juce::AudioPluginInstance* plugin) { pluginRetired(plugin); };
     startTimerHz(60); // repaint 60 times per second
 }
 
 PluginDropZone::~PluginDropZone() {
+        audioProcessor.pluginLoader.onPluginRetired = nullptr;
+
         if (pluginInstance)
         {
             auto& params = pluginInstance->getParameters();
@@ -404,46 +423,41 @@ void PluginDropZone::mouseDown(const juce::MouseEvent& event)
     if (!isClickOnPlus(event.getPosition())) 
         return;
 
-    // If a plugin is already loaded -> open its GUI
-    if (audioProcessor.hostedPlugin != nullptr)
+    // If a plugin is already loaded -> open the GUI of the last one in the chain
+    if (auto* processor = audioProcessor.rack.getLastPlugin())
     {
-        if (auto* instance = audioProcessor.hostedPlugin.get())
+        if (auto* ed = processor->createEditorIfNeeded())
         {
-            if (auto* ed = instance->createEditorIfNeeded())
-            {
-                editor.reset(ed);
-
-                // Plugin editor should not eat keyboard focus
-                ed->setWantsKeyboardFocus(false);
-                ed->setInterceptsMouseClicks(true, false);
-
-                addAndMakeVisible(editor.get());
-
-                // Animate appearance
-                static juce::ComponentAnimator animator;
-
-                // Target bounds: left side of Probe window (minus sidebar)
-                int sidebarWidth = 300;
-                auto fullArea = getLocalBounds();
-                auto pluginArea = fullArea.removeFromRight(sidebarWidth);
-
-                // Animate from collapsed to full height
-                ed->setBounds(pluginArea.withHeight(1));
-                animator.animateComponent(editor.get(),
-                    pluginArea,
-                    1.0f,   // final alpha
-                    300,    // ms duration
-                    true,   // use proxy
-                    0.0f,
-                    0.0f);
-
-                hostEditor.extend_panel = true;
-                hostEditor.togglePromptSidebar(hostEditor.extend_panel);
-            }
+            editor.reset(ed);
+
+            // Plugin editor should not eat keyboard focus
+            ed->setWantsKeyboardFocus(false);
+            ed->setInterceptsMouseClicks(true, false);
+
+            addAndMakeVisible(editor.get());
+
+            // Animate appearance
+            static juce::ComponentAnimator animator;
+
+            // Target bounds: left side of Probe window (minus sidebar)
+            int sidebarWidth = 300;
+            auto fullArea = getLocalBounds();
+            auto pluginArea = fullArea.removeFromRight(sidebarWidth);
+
+            // Animate from collapsed to full height
+            ed->setBounds(pluginArea.withHeight(1));
+            animator.animateComponent(editor.get(),
+                pluginArea,
+                1.0f,   // final alpha
+                300,    // ms duration
+                true,   // use proxy
+                0.0f,
+                0.0f);
+
+            hostEditor.extend_panel = true;
+            hostEditor.togglePromptSidebar(hostEditor.extend_panel);
         }
 
-        auto* processor = audioProcessor.hostedPlugin.get();
-
         DBG("Name: " << processor->getName());
         DBG("Inputs: " << processor->getTotalNumInputChannels());
         DBG("Outputs: " << processor->getTotalNumOutputChannels());
@@ -452,7 +466,7 @@ void PluginDropZone::mouseDown(const juce::MouseEvent& event)
         parameters.clear();
 
         int index = 0;
-        for (auto* param : audioProcessor.hostedPlugin->getParameters())
+        for (auto* param : processor->getParameters())
         {
 
             // Optional: filter out non-automatable or uninteresting params
@@ -515,51 +529,114 @@ void PluginDropZone::mouseDown(const juce::MouseEvent& event)
         menu.addItem(i + 1, pluginTypes[i].name);
     }
 
+    // Same list again, but starting a new branch that runs in parallel with the existing ones
+    constexpr int newBranchItemOffset = 10000;
+    if (audioProcessor.rack.getLastPlugin() != nullptr && audioProcessor.rack.size() < BranchRack::maxBranches)
+    {
+        juce::PopupMenu branchMenu;
+        for (int i = 0; i < pluginTypes.size(); ++i)
+            branchMenu.addItem(newBranchItemOffset + i + 1, pluginTypes[i].name);
+
+        menu.addSeparator();
+        menu.addSubMenu("New parallel branch", branchMenu);
+    }
+
+    // Swap the last plugin for another one while audio keeps running
+    constexpr int replaceItemOffset = 20000;
+    if (audioProcessor.rack.getLastPlugin() != nullptr)
+    {
+        juce::PopupMenu replaceMenu;
+        for (int i = 0; i < pluginTypes.size(); ++i)
+            replaceMenu.addItem(replaceItemOffset + i + 1, pluginTypes[i].name);
+
+        menu.addSubMenu("Replace last plugin", replaceMenu);
+    }
+
+    // Undo the last split, the main chain always stays
+    constexpr int removeBranchItem = 30000;
+    if (audioProcessor.rack.size() > 1)
+        menu.addItem(removeBranchItem, "Remove last parallel branch");
+
     // Show menu asynchronously, handle selection in lambda
 
     menu.showMenuAsync(juce::PopupMenu::Options(),
-        [this, pluginTypes](int result)
+        [this, pluginTypes, newBranchItemOffset, replaceItemOffset, removeBranchItem](int result)
         {
-            if (result > 0)
+            if (result == removeBranchItem)
             {
-                auto selectedPlugin = pluginTypes[result - 1];
-                DBG("User chose plugin: " << selectedPlugin.name);
-
-                // Example: create plugin instance
-                juce::String errorMessage;
-                auto instance = formatManager.createPluginInstance(
-                    selectedPlugin,
-                    audioProcessor.getSampleRate(),
-                    audioProcessor.getBlockSize(),
-                    errorMessage
-                );
-
-                if (instance == nullptr)
+                // Its plugins are destroyed with it, editors and listeners let go of them first
+                auto& rack = audioProcessor.rack;
+                auto lastBranch = rack.size() - 1;
+                if (auto* chain = rack.getChain(lastBranch))
+                    for (int i = 0; i < chain->size(); ++i)
+                        if (auto* plugin = chain->getPlugin(i))
+                            pluginRetired(plugin);
+
+                rack.removeBranch(lastBranch);
+                audioProcessor.updateChainLatency();
+                selectedPluginName = rack.getDescription();
+                repaint();
+            }
+            else if (result > 0)
+            {
+                // Plain items extend the last branch, the submenu items open a new one or replace a plugin
+                auto branchIndex = audioProcessor.rack.size() - 1;
+                auto nodeIndex = -1;
+                if (result > replaceItemOffset)
                 {
-                    DBG("Failed to load plugin: " << errorMessage);
+                    result -= replaceItemOffset;
+                    if (auto* chain = audioProcessor.rack.getChain(branchIndex))
+                        nodeIndex = chain->size() - 1;
                 }
-                else
+                else if (result > newBranchItemOffset)
                 {
-                    DBG("Plugin loaded successfully!");
-
-                    audioProcessor.hostedPlugin = std::move(instance);
-
-                    // Set stereo input/output channel layout
-                    audioProcessor.hostedPlugin->setPlayConfigDetails(2, 2,
-                        audioProcessor.getSampleRate(),
-                        audioProcessor.getBlockSize());
+                    result -= newBranchItemOffset;
+                    branchIndex = audioProcessor.rack.size();
+                }
 
-                    audioProcessor.hostedPlugin->prepareToPlay(audioProcessor.getSampleRate(), audioProcessor.getBlockSize());
-                    
+                auto selectedPlugin = pluginTypes[result - 1];
+                DBG("User chose plugin: " << selectedPlugin.name);
 
-                    selectedPluginName = selectedPlugin.name;
-                    repaint();
-                }
+                // Created and prepared in the background, the current chain keeps playing until it's ready
+                audioProcessor.pluginLoader.loadPlugin(selectedPlugin, branchIndex, nodeIndex,
+                    [safeThis = juce::Component::SafePointer<PluginDropZone>(this)](const juce::Result& loadResult)
+                    {
+                        if (safeThis == nullptr)
+                            return;
+
+                        if (loadResult.failed())
+                        {
+                            DBG("Failed to load plugin: " << loadResult.getErrorMessage());
+                            return;
+                        }
+
+                        DBG("Plugin loaded successfully!");
+                        safeThis->selectedPluginName = safeThis->audioProcessor.rack.getDescription();
+                        safeThis->repaint();
+                    });
             }
         });
 
 }
 
+void PluginDropZone::pluginRetired(juce::AudioPluginInstance* plugin)
+{
+    // Editors and parameter listeners have to let go before the instance is deleted
+    if (editor != nullptr && editor->getAudioProcessor() == plugin)
+        editor.reset();
+
+    if (!parameters.isEmpty() && plugin->getParameters().contains(parameters.getFirst()))
+    {
+        for (auto* param : parameters)
+            param->removeListener(this);
+
+        parameters.clear();
+        changedParameters.clear();
+        params_loaded = false;
+        hostEditor.clearParameterDisplays();
+    }
+}
+
 void PluginDropZone::parameterValueChanged(int parameterIndex, float newValue)
 {
     if (parameterIndex < parameters.size())
@@ -44,10 +44,10 @@ public:
 private:
     void mouseDown(const juce::MouseEvent& event) override;
     bool isClickOnPlus(const juce::Point<int>& pos);
+    void pluginRetired(juce::AudioPluginInstance* plugin);
 
     bool isDragOver = false;
     juce::VST3PluginFormat pluginFormat;
-    juce::AudioPluginFormatManager formatManager;
     juce::KnownPluginList pluginList;
 
     std::unique_ptr<juce::AudioProcessorEditor> editor; // hosted editor pointer
@@ -10,6 +10,15 @@ size_t WriteCallback(void* contents, size_t size, size_t nmemb, std::string* out
 
 }
 
+MetricSet ChainBuilderAudioProcessorEditor::getPromptMetrics()
+{
+    return { MetricId::spectralCentroid, MetricId::spectralRolloff, MetricId::spectralFlatness,
+             MetricId::resonanceScore, MetricId::pitch, MetricId::bandEnergy, MetricId::tonalBalance,
+             MetricId::rms, MetricId::loudness, MetricId::peak, MetricId::crestFactor,
+             MetricId::transientSharpness, MetricId::decay, MetricId::stereoCorrelation, MetricId::modulation,
+             MetricId::distortion, MetricId::intermodulation, MetricId::transferFunction, MetricId::sweep };
+}
+
 std::string ChainBuilderAudioProcessorEditor::prompt_gen()
 {
     const std::string url = "https://mydb-api-rpyo.onrender.com/generate_probe";
@@ -28,25 +37,41 @@ std::string ChainBuilderAudioProcessorEditor::prompt_gen()
         paramsJson[std::to_string(index)] = paramJson;
     }
 
+    // Every value in the payload from the same analysis pass
+    auto& metrics = audioProcessor.analysisThread.readMetrics();
+
     payload = {
         {"plugin_name", "AI EQ"},
         {"plugin_type", "Equalizer"},
 
-        {"spectral_centroid", std::to_string(audioProcessor.spectral_centroid)},
-        {"spectral_rolloff", std::to_string(audioProcessor.spectral_rolloff)},
-        {"spectral_flatness", std::to_string(audioProcessor.spectral_flatness)},
-        {"resonance_score", std::to_string(audioProcessor.resonance_score)},
-        {"harmonic_to_noise", std::to_string(audioProcessor.harmonic_to_noise)},
-
-        {"rms", std::to_string(audioProcessor.rms)},
-        {"lufs", std::to_string(audioProcessor.lufs)},
-        {"peak", std::to_string(audioProcessor.peak)},
-        {"crest_factor", std::to_string(audioProcessor.crest_factor)},
-        {"transient_sharpness", std::to_string(audioProcessor.transient_sharpness)},
-        {"decay_time", std::to_string(audioProcessor.decay_time)},
-
-        {"stereo_correlation", std::to_string(audioProcessor.stereo_correlation)},
-        {"modulation_depth", std::to_string(audioProcessor.modulation_depth)},
+        {"spectral_centroid", std::to_string(metrics.spectral_centroid)},
+        {"spectral_rolloff", std::to_string(metrics.spectral_rolloff)},
+        {"spectral_flatness", std::to_string(metrics.spectral_flatness)},
+        {"resonance_score", std::to_string(metrics.resonance_score)},
+        {"harmonic_to_noise", std::to_string(metrics.harmonic_to_noise)},
+        {"fundamental_frequency", std::to_string(metrics.fundamental_frequency)},
+        {"band_energy", metrics.band_energy},
+        {"tonal_balance", metrics.tonal_balance},
+
+        {"rms", std::to_string(metrics.rms)},
+        {"lufs", std::to_string(metrics.lufs)},
+        {"lufs_short_term", std::to_string(metrics.lufs_short_term)},
+        {"loudness_range", std::to_string(metrics.loudness_range)},
+        {"peak", std::to_string(metrics.peak)},
+        {"crest_factor", std::to_string(metrics.crest_factor)},
+        {"transient_sharpness", std::to_string(metrics.transient_sharpness)},
+        {"decay_time", std::to_string(metrics.decay_time)},
+
+        {"stereo_correlation", std::to_string(metrics.stereo_correlation)},
+        {"modulation_depth", std::to_string(metrics.modulation_depth)},
+        {"modulation_rate", std::to_string(metrics.modulation_rate)},
+        {"thd_percent", std::to_string(metrics.thd)},
+        {"thd_plus_noise_percent", std::to_string(metrics.thd_plus_noise)},
+        {"imd_percent", std::to_string(metrics.imd)},
+        {"frequency_response_db", metrics.frequency_response},
+        {"coherence", metrics.coherence},
+        {"sweep_thd_percent", std::to_string(metrics.sweep_thd)},
+        {"latency_ms", std::to_string(metrics.sweep_latency)},
 
         {"prompt", creative_text}
     };
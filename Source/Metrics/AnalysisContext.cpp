@@ -0,0 +1,34 @@
+#include "AnalysisContext.h"
+
+void AnalysisContext::prepare(double newSampleRate, int newFftSize, int newNumChannels)
+{
+    sampleRate = newSampleRate;
+    fftSize = newFftSize;
+    numChannels = juce::jmax(1, newNumChannels);
+
+    thirdOctaveBands.prepare(Filterbank::Scale::thirdOctave, fftSize, sampleRate);
+    barkBands.prepare(Filterbank::Scale::bark, fftSize, sampleRate);
+    melBands.prepare(Filterbank::Scale::mel, fftSize, sampleRate);
+
+    // Room for four spectrum-sized float arrays per channel (plus mid and side) and one second of per-sample
+    // work such as envelopes and decimated copies. Generous on purpose: running out is a bug, not a fallback.
+    auto numFloats = (size_t)fftSize * (size_t)(numChannels + 2) * 4 + (size_t)std::ceil(sampleRate);
+    capacity = numFloats * sizeof(float) + alignment * 64;
+
+    // Over-allocate so the first block can be aligned
+    rawStorage.allocate(capacity + alignment, false);
+    auto address = reinterpret_cast<std::uintptr_t>(rawStorage.get());
+    storage = reinterpret_cast<char*>((address + alignment - 1) & ~(std::uintptr_t)(alignment - 1));
+    used = 0;
+}
+
+const Filterbank& AnalysisContext::getFilterbank(Filterbank::Scale scale) const noexcept
+{
+    switch (scale)
+    {
+        case Filterbank::Scale::bark:   return barkBands;
+        case Filterbank::Scale::mel:    return melBands;
+        case Filterbank::Scale::thirdOctave:
+        default:                        return thirdOctaveBands;
+    }
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Filterbank.h"
+
+// ===============================================================================================================
+// Fixed-size scratch for one view into AnalysisContext memory. Valid until the context's frame is reset.
+template <typename Type>
+struct ScratchArray
+{
+    Type* data = nullptr;
+    int size = 0;
+
+    bool isEmpty() const noexcept { return size == 0; }
+    Type* begin() const noexcept { return data; }
+    Type* end() const noexcept { return data + size; }
+    Type& operator[](int index) const noexcept { return data[index]; }
+};
+
+// ===============================================================================================================
+// Everything a Metrics:: function needs to know about the analysis besides its input: sample rate, FFT size,
+// channel count, the filterbanks built for them, and a bump allocator for temporary arrays. The arena is allocated once in prepare() and
+// handed out front to back; beginFrame() rewinds it. So no metric touches the heap while analysing, and the
+// cost of a frame doesn't depend on what the allocator happens to be doing.
+class AnalysisContext
+{
+public:
+    AnalysisContext() = default;
+
+    // Allocates, call while the analysis thread is stopped
+    void prepare(double newSampleRate, int newFftSize, int newNumChannels);
+
+    double getSampleRate() const noexcept { return sampleRate; }
+    int getFftSize() const noexcept { return fftSize; }
+    int getNumChannels() const noexcept { return numChannels; }
+
+    const Filterbank& getThirdOctaveBands() const noexcept { return thirdOctaveBands; }
+    const Filterbank& getBarkBands() const noexcept { return barkBands; }
+    const Filterbank& getMelBands() const noexcept { return melBands; }
+    const Filterbank& getFilterbank(Filterbank::Scale scale) const noexcept;
+
+    // Releases everything allocated since the previous call, once per analysed frame
+    void beginFrame() noexcept { used = 0; }
+
+    // Uninitialised, 32-byte aligned. If the arena is exhausted this asserts and returns an empty array,
+    // so callers must cope with size 0 rather than grow.
+    template <typename Type>
+    ScratchArray<Type> allocate(int numElements) noexcept
+    {
+        static_assert(std::is_trivially_destructible<Type>::value, "The arena never runs destructors");
+
+        auto bytes = (sizeof(Type) * (size_t)juce::jmax(0, numElements) + alignment - 1) & ~(alignment - 1);
+        if (numElements <= 0 || used + bytes > capacity)
+        {
+            jassert(numElements <= 0);  // prepare() didn't reserve enough, raise the estimate there
+            return {};
+        }
+
+        auto* start = reinterpret_cast<Type*>(storage + used);
+        used += bytes;
+        return { start, numElements };
+    }
+
+    template <typename Type>
+    ScratchArray<Type> allocateCleared(int numElements) noexcept
+    {
+        auto array = allocate<Type>(numElements);
+        std::fill(array.begin(), array.end(), Type());
+        return array;
+    }
+
+    // Rewinds to where it was on construction, for metrics that only need scratch while they run
+    class ScopedMark
+    {
+    public:
+        explicit ScopedMark(AnalysisContext& c) noexcept : context(c), mark(c.used) {}
+        ~ScopedMark() { context.used = mark; }
+
+    private:
+        AnalysisContext& context;
+        size_t mark;
+
+        JUCE_DECLARE_NON_COPYABLE(ScopedMark)
+    };
+
+    size_t getBytesUsed() const noexcept { return used; }
+    size_t getCapacity() const noexcept { return capacity; }
+
+private:
+    static constexpr size_t alignment = 32;
+
+    double sampleRate = 44100.0;
+    int fftSize = 0;
+    int numChannels = 0;
+
+    Filterbank thirdOctaveBands, barkBands, melBands;
+
+    juce::HeapBlock<char> rawStorage;
+    char* storage = nullptr;                // rawStorage rounded up to the alignment
+    size_t capacity = 0, used = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(AnalysisContext)
+};
@@ -0,0 +1,198 @@
+#include "DecayMeter.h"
+#include "Metrics.h"
+
+void DecayMeter::prepare(double newSampleRate, int newNumChannels, double captureSeconds)
+{
+    sampleRate = newSampleRate;
+    numChannels = juce::jmax(1, newNumChannels);
+    captureLength = juce::jmax(1, (int)(captureSeconds * sampleRate));
+
+    ring.setSize(numChannels, captureLength * 2);
+    energy.allocate((size_t)captureLength, true);
+    filtered.allocate((size_t)captureLength, true);
+    curve.allocate((size_t)captureLength, true);
+
+    // Octave band-passes (RBJ, 0 dB peak, Q = sqrt 2 for one octave), run twice for steeper skirts
+    for (int band = 0; band < numOctaveBands; ++band)
+    {
+        auto centre = juce::jmin((double)getOctaveBandCentre(band), sampleRate * 0.45);
+        auto w0 = juce::MathConstants<double>::twoPi * centre / sampleRate;
+        auto alpha = std::sin(w0) / (2.0 * juce::MathConstants<double>::sqrt2);
+        auto a0 = 1.0 + alpha;
+
+        auto& f = bandFilters[(size_t)band];
+        f.b0 = (float)(alpha / a0);
+        f.b1 = 0.0f;
+        f.b2 = (float)(-alpha / a0);
+        f.a1 = (float)(-2.0 * std::cos(w0) / a0);
+        f.a2 = (float)((1.0 - alpha) / a0);
+    }
+
+    reset();
+}
+
+void DecayMeter::reset() noexcept
+{
+    ring.clear();
+    writePosition = numValid = sinceCapture = 0;
+    broadband = {};
+    octaveBands.fill({});
+    numCaptures = 0;
+}
+
+void DecayMeter::process(const juce::AudioBuffer<float>& buffer, int numSamples) noexcept
+{
+    auto channelsToCopy = juce::jmin(numChannels, buffer.getNumChannels());
+
+    for (int n = 0; n < numSamples;)
+    {
+        // Up to the end of the ring or the end of the period, whichever comes first
+        auto count = juce::jmin(numSamples - n, captureLength - writePosition, captureLength - sinceCapture);
+
+        for (int ch = 0; ch < channelsToCopy; ++ch)
+        {
+            ring.copyFrom(ch, writePosition, buffer, ch, n, count);
+            ring.copyFrom(ch, writePosition + captureLength, buffer, ch, n, count);
+        }
+
+        n += count;
+        writePosition = (writePosition + count) % captureLength;
+        numValid = juce::jmin(numValid + count, captureLength);
+        sinceCapture += count;
+
+        if (sinceCapture == captureLength)
+        {
+            sinceCapture = 0;
+            analyse();
+        }
+    }
+}
+
+void DecayMeter::analyse() noexcept
+{
+    if (numValid < captureLength)
+        return;
+
+    // The last period, oldest first, is one contiguous block thanks to the mirror
+    auto start = writePosition;
+
+    auto energyAt = [&](int n)
+    {
+        float e = 0.0f;
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            auto x = ring.getReadPointer(ch)[start + n];
+            e += x * x;
+        }
+        return e;
+    };
+
+    int peak = 0;
+    float loudest = -1.0f;
+    for (int n = 0; n < captureLength; ++n)
+    {
+        auto e = energyAt(n);
+        if (e > loudest)
+        {
+            loudest = e;
+            peak = n;
+        }
+    }
+
+    // The response starts at the earliest sample within 20 dB of the peak over the 20 ms before it (ISO 3382-1).
+    // It then runs to the end of the period and wraps into its start, which for a periodic excitation is the
+    // same response continuing.
+    int onset = peak;
+    auto searchLength = juce::jmin(captureLength - 1, (int)(sampleRate * 0.02));
+    for (int back = searchLength; back > 0; --back)
+    {
+        auto n = (peak - back + captureLength) % captureLength;
+        if (energyAt(n) >= loudest * 0.01f)
+        {
+            onset = n;
+            break;
+        }
+    }
+
+    auto responseStart = (start + onset) % captureLength;
+
+    // Broadband
+    std::fill(energy.get(), energy.get() + captureLength, 0.0f);
+    for (int ch = 0; ch < numChannels; ++ch)
+    {
+        auto* x = ring.getReadPointer(ch) + responseStart;
+        for (int n = 0; n < captureLength; ++n)
+            energy[n] += x[n] * x[n];
+    }
+    broadband = analyseEnergy();
+
+    // Octave bands: filter from the onset with cleared state, twice, then the same analysis
+    for (int band = 0; band < numOctaveBands; ++band)
+    {
+        auto& f = bandFilters[(size_t)band];
+        std::fill(energy.get(), energy.get() + captureLength, 0.0f);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            auto* x = ring.getReadPointer(ch) + responseStart;
+            auto* y = filtered.get();
+
+            for (int pass = 0; pass < 2; ++pass)
+            {
+                auto* in = pass == 0 ? x : y;
+                float z1 = 0.0f, z2 = 0.0f;     // transposed direct form II
+                for (int n = 0; n < captureLength; ++n)
+                {
+                    auto input = in[n];
+                    auto output = f.b0 * input + z1;
+                    z1 = f.b1 * input - f.a1 * output + z2;
+                    z2 = f.b2 * input - f.a2 * output;
+                    y[n] = output;
+                }
+            }
+
+            for (int n = 0; n < captureLength; ++n)
+                energy[n] += y[n] * y[n];
+        }
+
+        octaveBands[(size_t)band] = analyseEnergy();
+    }
+
+    ++numCaptures;
+}
+
+DecayMeter::DecayTimes DecayMeter::analyseEnergy() noexcept
+{
+    // Noise floor from the last 10 % of the period
+    auto noiseStart = captureLength - captureLength / 10;
+    double noiseSum = 0.0;
+    for (int n = noiseStart; n < captureLength; ++n)
+        noiseSum += energy[n];
+    auto noise = (float)(noiseSum / juce::jmax(1, captureLength - noiseStart));
+
+    // Truncate where 10 ms averages first come within 5 dB of the floor
+    auto blockLength = juce::jmax(1, (int)(sampleRate * 0.01));
+    auto truncation = noiseStart;
+    for (int block = 0; block + blockLength <= noiseStart; block += blockLength)
+    {
+        double sum = 0.0;
+        for (int n = block; n < block + blockLength; ++n)
+            sum += energy[n];
+
+        if (sum / blockLength < noise * 3.1623f)
+        {
+            truncation = block;
+            break;
+        }
+    }
+
+    Metrics::computeEnergyDecayCurve(energy.get(), captureLength, noise, truncation, curve.get());
+    auto truncationDb = Metrics::computeTruncationLevel(energy.get(), truncation, noise, sampleRate);
+
+    // Fits ending too close to the truncation come back 0, so a shallow decay falls back to T20 or EDT
+    DecayTimes times;
+    times.edt = Metrics::computeDecayFit(curve.get(), captureLength, sampleRate, 0.0f, -10.0f, truncationDb);
+    times.t20 = Metrics::computeDecayFit(curve.get(), captureLength, sampleRate, -5.0f, -25.0f, truncationDb);
+    times.t30 = Metrics::computeDecayFit(curve.get(), captureLength, sampleRate, -5.0f, -35.0f, truncationDb);
+    return times;
+}
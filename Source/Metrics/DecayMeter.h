@@ -0,0 +1,73 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// ===============================================================================================================
+// Reverb / delay decay times from the impulse-train stimulus.
+//
+// The response is recorded into a preallocated, mirrored ring exactly one impulse period long, so once a
+// period has gone by the ring holds one complete response whatever the alignment. Starting from the direct
+// sound (the loudest sample) that response is reduced to Schroeder energy decay curves, broadband and per
+// octave band, and EDT / T20 / T30 are fitted to them: once per impulse, not per block.
+//
+// The noise floor is estimated from the last 10 % of the period and subtracted before integrating, and the
+// integration stops where the decay meets it (ISO 3382-1 method B, simplified Lundeby truncation).
+class DecayMeter
+{
+public:
+    enum { numOctaveBands = 8 };    // 63 Hz .. 8 kHz
+
+    struct DecayTimes
+    {
+        float edt = 0.0f;   // seconds to decay 60 dB, fitted over 0 .. -10 dB
+        float t20 = 0.0f;   // -5 .. -25 dB
+        float t30 = 0.0f;   // -5 .. -35 dB
+
+        // The widest fit the noise floor allowed, 0 if none
+        float getRT60() const noexcept { return t30 > 0.0f ? t30 : (t20 > 0.0f ? t20 : edt); }
+    };
+
+    static float getOctaveBandCentre(int band) noexcept { return 62.5f * (float)(1 << band); }
+
+    DecayMeter() = default;
+
+    // Allocates, call before processing. captureSeconds should be the impulse period.
+    void prepare(double newSampleRate, int newNumChannels, double captureSeconds);
+    void reset() noexcept;
+
+    // Analysis thread: feed every sample exactly once while the impulse train is playing
+    void process(const juce::AudioBuffer<float>& buffer, int numSamples) noexcept;
+
+    bool hasReading() const noexcept { return numCaptures > 0; }
+    int getNumCaptures() const noexcept { return numCaptures; }
+
+    const DecayTimes& getBroadband() const noexcept { return broadband; }
+    const DecayTimes& getOctaveBand(int band) const noexcept { return octaveBands[(size_t)band]; }
+
+private:
+    struct Biquad
+    {
+        float b0 = 1.0f, b1 = 0.0f, b2 = 0.0f, a1 = 0.0f, a2 = 0.0f;
+    };
+
+    void analyse() noexcept;
+    DecayTimes analyseEnergy() noexcept;
+
+    double sampleRate = 44100.0;
+    int numChannels = 0;
+    int captureLength = 0;
+
+    juce::AudioBuffer<float> ring;          // numChannels x (2 * captureLength)
+    int writePosition = 0;
+    int numValid = 0;
+    int sinceCapture = 0;
+
+    juce::HeapBlock<float> energy, filtered, curve;
+    std::array<Biquad, numOctaveBands> bandFilters;
+
+    DecayTimes broadband;
+    std::array<DecayTimes, numOctaveBands> octaveBands;
+    int numCaptures = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DecayMeter)
+};
@@ -0,0 +1,90 @@
+#include "DistortionMeter.h"
+#include "FastMath.h"
+
+void DistortionMeter::prepare(const FftPlan& plan)
+{
+    jassert(plan.getWindowType() == FftPlan::Window::blackmanHarris);
+
+    sampleRate = plan.getSampleRate();
+    fftSize = plan.getSize();
+    fft = &plan.getFft();
+    window = plan.getWindow();
+
+    fftData.allocate((size_t)fftSize * 2, true);
+    magnitude.allocate((size_t)fftSize / 2 + 1, true);
+    power.allocate((size_t)fftSize / 2 + 1, true);
+    spectrum.prepare(plan);
+
+    reset();
+}
+
+void DistortionMeter::reset() noexcept
+{
+    average = {};
+    numAveraged = 0;
+}
+
+void DistortionMeter::process(const juce::AudioBuffer<float>& frame) noexcept
+{
+    auto numChannels = frame.getNumChannels();
+    if (numChannels == 0 || frame.getNumSamples() < fftSize)
+        return;
+
+    // Mono sum, windowed
+    auto* data = fftData.get();
+    auto channelGain = 1.0f / (float)numChannels;
+    juce::FloatVectorOperations::multiply(data, frame.getReadPointer(0), window, fftSize);
+    for (int ch = 1; ch < numChannels; ++ch)
+        juce::FloatVectorOperations::addWithMultiply(data, frame.getReadPointer(ch), window, fftSize);
+    juce::FloatVectorOperations::multiply(data, channelGain, fftSize);
+
+    fft->performRealOnlyForwardTransform(data, true);
+
+    auto numBins = fftSize / 2 + 1;
+    for (int k = 0; k < numBins; ++k)
+    {
+        power[k] = data[2 * k] * data[2 * k] + data[2 * k + 1] * data[2 * k + 1];
+        magnitude[k] = std::sqrt(power[k]);
+    }
+
+    spectrum.compute(magnitude.get(), power.get());
+    auto reading = Metrics::computeHarmonics(spectrum, lobeBins);
+    if (reading.fundamentalPower <= 0.0)
+        return;
+
+    // Too few bins below the fundamental to separate its harmonics: no reading rather than a THD of 0
+    if (!reading.resolved)
+    {
+        reset();
+        return;
+    }
+
+    // A different tone is a different measurement
+    if (numAveraged > 0 && std::abs(reading.fundamentalHz - average.fundamentalHz) > spectrum.getBinWidth())
+        numAveraged = 0;
+
+    // Running mean over the first frames, then an exponential average with the same time constant
+    numAveraged = juce::jmin(numAveraged + 1, (int)averagingFrames);
+    auto weight = 1.0 / numAveraged;
+    auto blend = [weight](auto& mean, double value)
+    {
+        mean = static_cast<std::remove_reference_t<decltype(mean)>>(mean + (value - mean) * weight);
+    };
+
+    blend(average.fundamentalHz, reading.fundamentalHz);
+    blend(average.fundamentalPower, reading.fundamentalPower);
+    blend(average.harmonicPower, reading.harmonicPower);
+    blend(average.totalPower, reading.totalPower);
+    for (size_t h = 0; h < average.harmonics.size(); ++h)
+        blend(average.harmonics[h], reading.harmonics[h]);
+}
+
+float DistortionMeter::getHarmonicLevel(int h) const noexcept
+{
+    auto index = h - 2;
+    if (index < 0 || index >= Metrics::HarmonicAnalysis::maxHarmonics || average.fundamentalPower <= 0.0)
+        return -200.0f;
+
+    auto ratio = (float)(average.harmonics[(size_t)index] / average.fundamentalPower);
+    return ratio > 1e-20f ? FastMath::powerToDecibels(ratio) : -200.0f;
+}
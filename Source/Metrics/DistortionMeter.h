@@ -0,0 +1,56 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "SpectrumFrame.h"
+#include "Metrics.h"
+
+// ===============================================================================================================
+// THD and THD+N of the hosted plugin while the sine stimulus drives it.
+//
+// Each frame is reduced to mono, windowed with a 4-term Blackman-Harris (sidelobes at -92 dB, so leakage
+// from the fundamental stays below the harmonics of any plugin worth measuring) and analysed with
+// Metrics::computeHarmonics. Powers are averaged over the last averagingFrames frames, incrementally, so a
+// stable reading settles within a few hundred milliseconds and then tracks changes at the same rate. The
+// average restarts when the fundamental moves.
+class DistortionMeter
+{
+public:
+    enum
+    {
+        averagingFrames = 16,    // ~350 ms at 48 kHz with the default hop
+        lobeBins = 4             // Blackman-Harris main lobe half width
+    };
+
+    DistortionMeter() = default;
+
+    // Allocates. plan must be a Blackman-Harris one and outlive this. Analysis thread or while it is stopped.
+    void prepare(const FftPlan& plan);
+    void reset() noexcept;
+
+    // Analysis thread: one fftSize frame, any number of channels
+    void process(const juce::AudioBuffer<float>& frame) noexcept;
+
+    // False until a frame was analysed, and while the fundamental is too low for this FFT size to resolve
+    bool hasReading() const noexcept { return numAveraged > 0; }
+
+    float getTHD() const noexcept { return average.getTHD(); }                    // ratio
+    float getTHDPlusNoise() const noexcept { return average.getTHDPlusNoise(); }  // ratio
+    float getFundamentalFrequency() const noexcept { return average.fundamentalHz; }
+
+    // Harmonic h (2 .. maxHarmonics + 1) in dB relative to the fundamental
+    float getHarmonicLevel(int h) const noexcept;
+
+private:
+    double sampleRate = 44100.0;
+    int fftSize = 0;
+
+    const juce::dsp::FFT* fft = nullptr;    // the plan's
+    const float* window = nullptr;
+    juce::HeapBlock<float> fftData, magnitude, power;
+    SpectrumFrame spectrum;
+
+    Metrics::HarmonicAnalysis average;
+    int numAveraged = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(DistortionMeter)
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+// ===============================================================================================================
+// Branch-free float log2 / exp2 for the metric kernels. Both are plain arithmetic on the IEEE-754 bits, so
+// loops calling them vectorise.
+//
+// Error bounds, measured against double precision:
+//   log2(x)  absolute error < 1.1e-6 for x in [1e-3, 8e6], < 4e-6 over all positive normal floats
+//            (both are the rounding of the float result, the series itself is good to ~1e-8)
+//   exp2(x)  relative error < 3e-7 for |x| <= 20, < 3e-6 up to the clamp at -126 / 127
+// So the dB helpers are within 3e-5 dB everywhere, far under anything the metrics report.
+// Zero, negative and non-finite inputs are not handled: callers add their own floor.
+namespace FastMath
+{
+    inline float bitsToFloat(uint32_t bits) noexcept
+    {
+        float f;
+        std::memcpy(&f, &bits, sizeof(f));
+        return f;
+    }
+
+    inline uint32_t floatToBits(float f) noexcept
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &f, sizeof(bits));
+        return bits;
+    }
+
+    // x = 2^e * m with m in [sqrt(0.5), sqrt(2)), then log2(m) = 2 / ln 2 * atanh(t), t = (m - 1) / (m + 1)
+    inline float log2(float x) noexcept
+    {
+        auto bits = floatToBits(x);
+
+        // Re-centre the mantissa around 1 by borrowing from the exponent when m >= sqrt(2)
+        auto shifted = bits - 0x3f3504f3u;                          // bits of sqrt(0.5)
+        auto exponent = (int32_t)shifted >> 23;
+        auto m = bitsToFloat(bits - ((uint32_t)exponent << 23));    // in [sqrt(0.5), sqrt(2))
+
+        auto t = (m - 1.0f) / (m + 1.0f);                           // |t| < 0.1716
+        auto t2 = t * t;
+        auto series = t * (2.8853900818f + t2 * (0.9617966939f + t2 * (0.5770780164f + t2 * 0.4121985831f)));
+
+        return (float)exponent + series;
+    }
+
+    // x = n + f with n = round(x), |f| <= 0.5, then 2^f from its Taylor series in f * ln 2
+    inline float exp2(float x) noexcept
+    {
+        x = x < -126.0f ? -126.0f : (x > 127.0f ? 127.0f : x);
+
+        auto n = std::floor(x + 0.5f);
+        auto f = (x - n) * 0.6931471806f;
+
+        auto p = 1.0f + f * (1.0f + f * (0.5f + f * (0.1666666667f + f * (0.0416666667f
+                      + f * (0.0083333333f + f * 0.0013888889f)))));
+
+        return p * bitsToFloat((uint32_t)((int32_t)n + 127) << 23);
+    }
+
+    inline float log10(float x) noexcept { return log2(x) * 0.3010299957f; }
+    inline float exp10(float x) noexcept { return exp2(x * 3.3219280949f); }
+
+    // Same contract as juce::Decibels, minus the clamp to a floor
+    inline float gainToDecibels(float gain) noexcept { return 6.0205999133f * log2(gain); }
+    inline float decibelsToGain(float decibels) noexcept { return exp2(decibels * 0.1660964047f); }
+    inline float powerToDecibels(float power) noexcept { return 3.0102999566f * log2(power); }
+}
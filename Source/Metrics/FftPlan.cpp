@@ -0,0 +1,75 @@
+#include "FftPlan.h"
+
+FftPlan::FftPlan(int newOrder, Window newWindow, double newSampleRate)
+    : order(newOrder),
+      size(1 << newOrder),
+      windowType(newWindow),
+      sampleRate(newSampleRate),
+      fft(newOrder)
+{
+    using Windowing = juce::dsp::WindowingFunction<float>;
+    auto method = windowType == Window::blackmanHarris ? Windowing::blackmanHarris
+                : windowType == Window::flatTop ? Windowing::flatTop
+                : windowType == Window::kaiser ? Windowing::kaiser
+                : Windowing::hann;
+
+    // normalise = true scales the window to sum to size, i.e. unit coherent gain
+    window.allocate((size_t)size, true);
+    Windowing::fillWindowingTables(window.get(), (size_t)size, method, true, kaiserBeta);
+
+    double sumOfSquares = 0.0;
+    for (int n = 0; n < size; ++n)
+        sumOfSquares += (double)window[n] * window[n];
+
+    powerGain = (float)(sumOfSquares / size);
+    noiseBandwidth = powerGain;                     // N sum w^2 / (sum w)^2 with sum w = N
+    meanSquareScale = (float)(2.0 / (size * sumOfSquares));
+
+    frequencies.allocate((size_t)getNumBins(), true);
+    for (int k = 0; k < getNumBins(); ++k)
+        frequencies[k] = (float)(k * getBinWidth());
+}
+
+juce::StringArray FftPlan::getWindowNames()
+{
+    return { "Hann", "Blackman-Harris", "Flat Top", "Kaiser" };
+}
+
+int FftPlan::getMainLobeBins(Window window) noexcept
+{
+    switch (window)
+    {
+        case Window::hann:              return 2;
+        case Window::blackmanHarris:    return 4;
+        case Window::flatTop:           return 5;
+        case Window::kaiser:
+        {
+            auto ratio = kaiserBeta / juce::MathConstants<float>::pi;
+            return (int)std::ceil(std::sqrt(1.0f + ratio * ratio));
+        }
+    }
+
+    return 2;
+}
+
+// =============================
+// FftPlanCache
+// =============================
+void FftPlanCache::prepare(double newSampleRate)
+{
+    if (newSampleRate != sampleRate)
+        plans.clear();
+
+    sampleRate = newSampleRate;
+}
+
+const FftPlan& FftPlanCache::get(int order, FftPlan::Window window)
+{
+    order = juce::jlimit((int)FftPlan::minOrder, (int)FftPlan::maxOrder, order);
+
+    auto& plan = plans[order * 8 + (int)window];
+    if (plan == nullptr)
+        plan = std::make_unique<FftPlan>(order, window, sampleRate);
+
+    return *plan;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// ===============================================================================================================
+// Everything a spectral analysis needs that depends only on (FFT size, window, sample rate): the FFT object,
+// the window table, the bin frequencies and the window's gain corrections.
+//
+// Windows are normalised to a coherent gain of 1 (mean of w = 1), so a bin-centred sine reads the same
+// magnitude whichever window is selected and magnitude-based metrics don't jump on a switch. Power-based
+// consumers correct with getMeanSquareScale() or getNoiseBandwidth() instead.
+//
+// Plans are immutable once built and juce::dsp::FFT::perform is const, so any number of consumers on the
+// analysis thread share one.
+class FftPlan
+{
+public:
+    enum class Window
+    {
+        hann,               // the default, good all-round leakage / resolution trade-off
+        blackmanHarris,     // 4-term, sidelobes at -92 dB, for distortion
+        flatTop,            // amplitude accurate to ~0.01 dB wherever the tone falls between bins
+        kaiser              // beta = kaiserBeta, sidelobes around -70 dB
+    };
+
+    enum
+    {
+        minOrder = 8,       // 256
+        maxOrder = 16,      // 65536
+        defaultOrder = 12   // 4096
+    };
+
+    static constexpr float kaiserBeta = 9.0f;
+
+    FftPlan(int newOrder, Window newWindow, double newSampleRate);
+
+    static juce::StringArray getWindowNames();
+    // Half width of the window's main lobe in bins, rounded up: a tone leaks into this many bins either side
+    static int getMainLobeBins(Window window) noexcept;
+
+    int getOrder() const noexcept { return order; }
+    int getSize() const noexcept { return size; }
+    int getNumBins() const noexcept { return size / 2 + 1; }   // DC to Nyquist
+    Window getWindowType() const noexcept { return windowType; }
+    int getMainLobeBins() const noexcept { return getMainLobeBins(windowType); }
+    double getSampleRate() const noexcept { return sampleRate; }
+    double getBinWidth() const noexcept { return sampleRate / size; }
+
+    const juce::dsp::FFT& getFft() const noexcept { return fft; }
+    const float* getWindow() const noexcept { return window.get(); }           // size values
+    const float* getFrequencies() const noexcept { return frequencies.get(); } // getNumBins() values, Hz
+
+    // Window corrections. Coherent gain is 1 by construction, these are what's left.
+    float getPowerGain() const noexcept { return powerGain; }           // mean of w^2
+    float getNoiseBandwidth() const noexcept { return noiseBandwidth; } // equivalent noise bandwidth, bins
+    float getMeanSquareScale() const noexcept { return meanSquareScale; } // one-sided |X|^2 to mean square, 2 / (N sum w^2)
+
+private:
+    int order = 0;
+    int size = 0;
+    Window windowType = Window::hann;
+    double sampleRate = 44100.0;
+
+    juce::dsp::FFT fft;
+    juce::HeapBlock<float> window, frequencies;
+    float powerGain = 1.0f, noiseBandwidth = 1.0f, meanSquareScale = 1.0f;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FftPlan)
+};
+
+// ===============================================================================================================
+// Builds each FftPlan the first time it is asked for and keeps it, so switching between configurations
+// (a fast low-latency size and a high-resolution one, say) only costs the build once per configuration.
+// Analysis thread only. References stay valid until the next prepare().
+class FftPlanCache
+{
+public:
+    FftPlanCache() = default;
+
+    // Forgets every plan if the sample rate changed. Call while nothing holds a plan (prepareToPlay).
+    void prepare(double newSampleRate);
+
+    // order is clamped to [minOrder, maxOrder]
+    const FftPlan& get(int order, FftPlan::Window window);
+
+private:
+    double sampleRate = 0.0;
+    std::map<int, std::unique_ptr<FftPlan>> plans;     // keyed by order * 8 + window
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(FftPlanCache)
+};
@@ -0,0 +1,138 @@
+#include "Filterbank.h"
+
+namespace
+{
+    constexpr int rowAlignment = 8;
+
+    // Band edges of Zwicker's 24 critical bands
+    constexpr float barkEdges[Filterbank::numBarkBands + 1] = {
+        0.0f, 100.0f, 200.0f, 300.0f, 400.0f, 510.0f, 630.0f, 770.0f, 920.0f, 1080.0f, 1270.0f, 1480.0f, 1720.0f,
+        2000.0f, 2320.0f, 2700.0f, 3150.0f, 3700.0f, 4400.0f, 5300.0f, 6400.0f, 7700.0f, 9500.0f, 12000.0f, 15500.0f
+    };
+
+    float hzToMel(float hz) { return 2595.0f * std::log10(1.0f + hz / 700.0f); }
+    float melToHz(float mel) { return 700.0f * (std::pow(10.0f, mel / 2595.0f) - 1.0f); }
+}
+
+void Filterbank::prepare(Scale newScale, int fftSize, double sampleRate)
+{
+    scale = newScale;
+    numBins = fftSize / 2 + 1;
+    binWidth = sampleRate / fftSize;
+
+    bands.clear();
+    weights.clear();
+
+    switch (scale)
+    {
+        case Scale::thirdOctave:
+            // Base-2 centres, band 17 at 1 kHz
+            for (int b = 0; b < numThirdOctaveBands; ++b)
+            {
+                auto centre = 1000.0f * std::exp2((float)(b - 17) / 3.0f);
+                addRectangularBand(centre * std::exp2(-1.0f / 6.0f), centre * std::exp2(1.0f / 6.0f), centre);
+            }
+            break;
+
+        case Scale::bark:
+            for (int b = 0; b < numBarkBands; ++b)
+                addRectangularBand(barkEdges[b], barkEdges[b + 1], 0.5f * (barkEdges[b] + barkEdges[b + 1]));
+            break;
+
+        case Scale::mel:
+        {
+            auto maxMel = hzToMel((float)(sampleRate * 0.5));
+            for (int b = 0; b < numMelBands; ++b)
+                addTriangularBand(melToHz(maxMel * (float)b / (numMelBands + 1)),
+                                  melToHz(maxMel * (float)(b + 1) / (numMelBands + 1)),
+                                  melToHz(maxMel * (float)(b + 2) / (numMelBands + 1)));
+            break;
+        }
+    }
+}
+
+void Filterbank::apply(const float* power, float* bandPower) const noexcept
+{
+    auto* allWeights = weights.data();
+
+    for (size_t b = 0; b < bands.size(); ++b)
+    {
+        auto& band = bands[b];
+        auto* w = allWeights + band.offset;
+        auto* p = power + band.startBin;
+
+        float acc[rowAlignment] = {};
+        for (int k = 0; k < band.numWeights; k += rowAlignment)
+            for (int i = 0; i < rowAlignment; ++i)
+                acc[i] += w[k + i] * p[k + i];
+
+        float sum = 0.0f;
+        for (auto a : acc)
+            sum += a;
+
+        bandPower[b] = sum;
+    }
+}
+
+void Filterbank::addRectangularBand(float lowHz, float highHz, float centreHz)
+{
+    auto firstBin = (int)std::ceil(lowHz / binWidth);
+    auto endBin = juce::jmin(numBins, (int)std::ceil(highHz / binWidth));
+
+    if (firstBin >= numBins)
+    {
+        addBand(0, {}, centreHz);
+        return;
+    }
+
+    if (endBin <= firstBin)
+    {
+        // No bin centre inside the band: take its share of the bin it sits in
+        auto bin = juce::jlimit(0, numBins - 1, juce::roundToInt(centreHz / binWidth));
+        addBand(bin, { (float)((highHz - lowHz) / binWidth) }, centreHz);
+        return;
+    }
+
+    addBand(firstBin, std::vector<float>((size_t)(endBin - firstBin), 1.0f), centreHz);
+}
+
+void Filterbank::addTriangularBand(float lowHz, float centreHz, float highHz)
+{
+    auto firstBin = (int)std::ceil(lowHz / binWidth);
+    auto endBin = juce::jmin(numBins, (int)std::ceil(highHz / binWidth));
+
+    std::vector<float> row;
+    for (int k = firstBin; k < endBin; ++k)
+    {
+        auto f = (float)(k * binWidth);
+        row.push_back(f <= centreHz ? (f - lowHz) / (centreHz - lowHz) : (highHz - f) / (highHz - centreHz));
+    }
+
+    if (row.empty())
+    {
+        // Narrower than a bin (low mel bands at small FFT sizes): the nearest bin at full weight
+        firstBin = juce::jlimit(0, numBins - 1, juce::roundToInt(centreHz / binWidth));
+        row.push_back(1.0f);
+    }
+
+    addBand(firstBin, std::move(row), centreHz);
+}
+
+void Filterbank::addBand(int firstBin, std::vector<float> rowWeights, float centreHz)
+{
+    Band band;
+    band.centreHz = centreHz;
+    band.offset = (int)weights.size();
+    band.numWeights = ((int)rowWeights.size() + rowAlignment - 1) & ~(rowAlignment - 1);
+    jassert(band.numWeights <= numBins);
+
+    // Pad at the end, or shift the row left and pad at the front if it would read past the last bin
+    auto lead = juce::jmax(0, firstBin + band.numWeights - numBins);
+    band.startBin = firstBin - lead;
+
+    weights.insert(weights.end(), (size_t)lead, 0.0f);
+    weights.insert(weights.end(), rowWeights.begin(), rowWeights.end());
+    weights.resize((size_t)(band.offset + band.numWeights), 0.0f);
+
+    bands.push_back(band);
+}
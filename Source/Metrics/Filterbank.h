@@ -0,0 +1,63 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// ===============================================================================================================
+// Maps a power spectrum onto perceptual bands with a weight table built once per (sample rate, FFT size).
+//
+// Every band covers a contiguous run of bins, so the table is stored sparse as one dense row per band
+// (first bin + weights) rather than with per-entry column indices: apply() is a short dot product per band
+// with no gather. Rows are zero-padded to a multiple of 8 so that product vectorises without a scalar tail.
+class Filterbank
+{
+public:
+    enum class Scale
+    {
+        thirdOctave,    // 31 ISO bands, 20 Hz .. 20 kHz, rectangular
+        bark,           // 24 Zwicker critical bands, rectangular
+        mel             // 40 HTK mel triangles, 0 Hz .. Nyquist, unit peak
+    };
+
+    enum
+    {
+        numThirdOctaveBands = 31,
+        numBarkBands = 24,
+        numMelBands = 40
+    };
+
+    Filterbank() = default;
+
+    // Allocates, call while the analysis thread is stopped
+    void prepare(Scale newScale, int fftSize, double sampleRate);
+
+    // power holds fftSize / 2 + 1 bins, bandPower receives getNumBands() values.
+    // Bands above Nyquist come out as 0.
+    void apply(const float* power, float* bandPower) const noexcept;
+
+    Scale getScale() const noexcept { return scale; }
+    int getNumBands() const noexcept { return (int)bands.size(); }
+    float getCentreFrequency(int band) const noexcept { return bands[(size_t)band].centreHz; }
+
+private:
+    struct Band
+    {
+        int startBin = 0;
+        int numWeights = 0;     // multiple of 8
+        int offset = 0;         // into weights
+        float centreHz = 0.0f;
+    };
+
+    // Rectangular band [lowHz, highHz). A band narrower than a bin takes the share of the bin it covers.
+    void addRectangularBand(float lowHz, float highHz, float centreHz);
+    void addTriangularBand(float lowHz, float centreHz, float highHz);
+    void addBand(int firstBin, std::vector<float> rowWeights, float centreHz);
+
+    Scale scale = Scale::thirdOctave;
+    int numBins = 0;
+    double binWidth = 1.0;
+
+    std::vector<Band> bands;
+    std::vector<float> weights;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(Filterbank)
+};
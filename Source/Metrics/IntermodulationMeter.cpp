@@ -0,0 +1,109 @@
+#include "IntermodulationMeter.h"
+#include "FastMath.h"
+#include "../Engine/StimulusGenerator.h"
+
+IntermodulationMeter::Tones IntermodulationMeter::getTones(Standard standard, double sampleRate, int fftSize)
+{
+    auto binWidth = sampleRate / fftSize;
+    auto lastBin = fftSize / 2 - 1;
+    auto toBin = [&](double hz) { return juce::jlimit(1, lastBin, juce::roundToInt(hz / binWidth)); };
+
+    Tones tones;
+    if (standard == Standard::smpte)
+    {
+        tones.lowBin = toBin(60.0);
+        tones.highBin = toBin(7000.0);
+        tones.lowGain = 0.8f;
+        tones.highGain = 0.2f;
+    }
+    else
+    {
+        // Below 48 kHz the pair moves down, 1 kHz apart, to leave room for the upper products
+        tones.highBin = toBin(juce::jmin(20000.0, sampleRate * 0.45));
+        tones.lowBin = toBin(juce::jmin(19000.0, sampleRate * 0.45 - 1000.0));
+        tones.lowGain = tones.highGain = 0.5f;
+    }
+    return tones;
+}
+
+void IntermodulationMeter::prepare(Standard newStandard, double sampleRate, int fftSize, int lobeBins)
+{
+    standard = newStandard;
+    resolvable = fftSize >= StimulusGenerator::periodicTableLength;
+    tones = getTones(standard, sampleRate, StimulusGenerator::periodicTableLength);
+    binScale = (double)fftSize / StimulusGenerator::periodicTableLength;
+
+    referenceBinA = toAnalysisBin(tones.highBin);
+    referenceBinB = standard == Standard::ccif ? toAnalysisBin(tones.lowBin) : -1;
+
+    // Products are worked out in stimulus bins, so their frequencies stay exact whatever the analysis size
+    auto binWidth = sampleRate / StimulusGenerator::periodicTableLength;
+    auto numBins = fftSize / 2 + 1;
+    auto f1 = tones.lowBin, f2 = tones.highBin;
+
+    numGroups = numProducts = 0;
+    imd = 0.0f;
+    productLevel.fill(0.0f);
+
+    if (!resolvable)
+        return;
+
+    if (standard == Standard::smpte)
+    {
+        for (int n = 1; n <= 4; ++n)
+            addGroup(f2 - n * f1, f2 + n * f1, binWidth, numBins, lobeBins);
+    }
+    else
+    {
+        addGroup(f2 - f1, -1, binWidth, numBins, lobeBins);
+        addGroup(2 * f1 - f2, 2 * f2 - f1, binWidth, numBins, lobeBins);
+        addGroup(3 * f1 - 2 * f2, 3 * f2 - 2 * f1, binWidth, numBins, lobeBins);
+    }
+}
+
+int IntermodulationMeter::toAnalysisBin(int stimulusBin) const noexcept
+{
+    return stimulusBin > 0 ? juce::roundToInt(stimulusBin * binScale) : -1;
+}
+
+void IntermodulationMeter::addGroup(int lowerBin, int upperBin, double binWidth, int numBins, int lobeBins)
+{
+    // Inside a tone's main lobe the bin reads the tone's leakage, not the product
+    auto clearOfTones = [&](int bin)
+    {
+        return std::abs(bin - toAnalysisBin(tones.lowBin)) > lobeBins && std::abs(bin - toAnalysisBin(tones.highBin)) > lobeBins;
+    };
+    auto valid = [&](int bin) { return bin > 0 && bin < numBins && clearOfTones(bin); };
+
+    Metrics::IntermodulationGroup group;
+    for (auto stimulusBin : { lowerBin, upperBin })
+    {
+        auto bin = toAnalysisBin(stimulusBin);
+        if (!valid(bin) || numProducts >= maxProducts)
+            continue;
+
+        (group.lowerBin < 0 ? group.lowerBin : group.upperBin) = bin;
+        productBins[(size_t)numProducts] = bin;
+        productHz[(size_t)numProducts] = (float)(stimulusBin * binWidth);
+        ++numProducts;
+    }
+
+    if (group.lowerBin >= 0 && numGroups < maxProducts)
+        groups[(size_t)numGroups++] = group;
+}
+
+void IntermodulationMeter::process(const SpectrumFrame& spectrum) noexcept
+{
+    if (!resolvable)
+        return;
+
+    imd = Metrics::computeIntermodulationDistortion(spectrum, referenceBinA, referenceBinB, groups.data(), numGroups);
+
+    auto* magnitude = spectrum.getMagnitude();
+    auto reference = magnitude[referenceBinA] + (referenceBinB >= 0 ? magnitude[referenceBinB] : 0.0f);
+    for (int i = 0; i < numProducts; ++i)
+    {
+        auto ratio = reference > 0.0f ? magnitude[productBins[(size_t)i]] / reference : 0.0f;
+        productLevel[(size_t)i] = ratio > 1e-10f ? FastMath::gainToDecibels(ratio) : -200.0f;
+    }
+}
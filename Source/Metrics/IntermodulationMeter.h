@@ -0,0 +1,79 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "SpectrumFrame.h"
+#include "Metrics.h"
+
+// ===============================================================================================================
+// Two-tone intermodulation distortion, read from the shared analysis spectrum.
+//
+// The stimulus tones sit exactly on bins of the generator's periodic table (see getTones()), and so on bins of
+// any analysis FFT at least that long: each tone and each product lands on a single known bin. Shorter FFTs
+// can't separate them (the tones leak and the products collapse onto the tone bins), so they give no reading.
+// Products inside the window's main lobe around a tone would only measure that tone and are left out too.
+// prepare() works out those bins once; process() is then a handful of magnitude lookups per frame, no FFT or
+// search of its own.
+//
+//   SMPTE (RP120 / DIN 45403): 60 Hz + 7 kHz at 4:1. Sidebands f2 +- n * f1 for n = 1 .. 4, each pair summed in
+//                              amplitude, orders summed in power, relative to the 7 kHz tone.
+//   CCIF (IEC 60268-3):        19 kHz + 20 kHz at 1:1. Difference-frequency products f2 - f1, 2f1 - f2 / 2f2 - f1
+//                              and 3f1 - 2f2 / 3f2 - 2f1, relative to the sum of both tones.
+class IntermodulationMeter
+{
+public:
+    enum class Standard
+    {
+        smpte,
+        ccif
+    };
+
+    enum { maxProducts = 8 };
+
+    // Stimulus tones snapped onto bins of an fftSize analysis, peak amplitude 1 at unity level
+    struct Tones
+    {
+        int lowBin = 0, highBin = 0;
+        float lowGain = 0.0f, highGain = 0.0f;
+    };
+
+    static Tones getTones(Standard standard, double sampleRate, int fftSize);
+
+    IntermodulationMeter() = default;
+
+    // Analysis thread, or while it is stopped. lobeBins is the analysis window's main lobe half width.
+    void prepare(Standard newStandard, double sampleRate, int fftSize, int lobeBins);
+
+    // spectrum must come from the same fftSize and sample rate as prepare()
+    void process(const SpectrumFrame& spectrum) noexcept;
+
+    Standard getStandard() const noexcept { return standard; }
+    // False for analysis FFTs shorter than the stimulus table, which can't resolve the products
+    bool hasReading() const noexcept { return resolvable; }
+
+    float getIMD() const noexcept { return imd; }                       // ratio
+    int getNumProducts() const noexcept { return numProducts; }
+    float getProductFrequency(int index) const noexcept { return productHz[(size_t)index]; }
+    float getProductLevel(int index) const noexcept { return productLevel[(size_t)index]; }  // dB re. reference
+
+private:
+    // Bins of the stimulus table in, bins of the analysis out
+    int toAnalysisBin(int stimulusBin) const noexcept;
+    void addGroup(int lowerBin, int upperBin, double binWidth, int numBins, int lobeBins);
+
+    Standard standard = Standard::smpte;
+    bool resolvable = false;
+    Tones tones;
+    double binScale = 1.0;                  // fftSize / StimulusGenerator::periodicTableLength
+    int referenceBinA = 0, referenceBinB = -1;
+
+    std::array<Metrics::IntermodulationGroup, maxProducts> groups;
+    int numGroups = 0;
+
+    std::array<int, maxProducts> productBins{};
+    std::array<float, maxProducts> productHz{}, productLevel{};
+    int numProducts = 0;
+
+    float imd = 0.0f;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(IntermodulationMeter)
+};
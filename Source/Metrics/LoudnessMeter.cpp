@@ -0,0 +1,261 @@
+#include "LoudnessMeter.h"
+#include "FastMath.h"
+
+namespace
+{
+    constexpr double absoluteGate = -70.0;             // LUFS
+    constexpr double integratedRelativeGate = -10.0;   // LU, BS.1770-4
+    constexpr double rangeRelativeGate = -20.0;        // LU, EBU Tech 3342
+    constexpr double binWidth = 0.1;                   // LU
+}
+
+// =============================
+// Histogram
+// =============================
+void LoudnessMeter::Histogram::add(double power, double loudness) noexcept
+{
+    auto bin = binOf(loudness);
+    ++counts[(size_t)bin];
+    powers[(size_t)bin] += power;
+    ++total;
+}
+
+void LoudnessMeter::Histogram::clear() noexcept
+{
+    counts.fill(0);
+    powers.fill(0.0);
+    total = 0;
+}
+
+// =============================
+// LoudnessMeter
+// =============================
+void LoudnessMeter::prepare(double newSampleRate, int newNumChannels)
+{
+    sampleRate = newSampleRate;
+    channels.assign((size_t)juce::jmax(1, newNumChannels), {});
+
+    // K-weighting for any sample rate, from the analogue prototypes behind the 48 kHz tables in BS.1770
+    ChannelState prototype;
+    {
+        // Stage 1: high shelf, about +4 dB above 1.5 kHz
+        const double f0 = 1681.974450955533, gainDb = 3.999843853973347, q = 0.7071752369554196;
+        auto k = std::tan(juce::MathConstants<double>::pi * f0 / sampleRate);
+        auto vh = std::pow(10.0, gainDb / 20.0);
+        auto vb = std::pow(vh, 0.4996667741545416);
+        auto a0 = 1.0 + k / q + k * k;
+
+        auto& s = prototype.shelf;
+        s.b0 = (vh + vb * k / q + k * k) / a0;
+        s.b1 = 2.0 * (k * k - vh) / a0;
+        s.b2 = (vh - vb * k / q + k * k) / a0;
+        s.a1 = 2.0 * (k * k - 1.0) / a0;
+        s.a2 = (1.0 - k / q + k * k) / a0;
+    }
+    {
+        // Stage 2: RLB high-pass around 38 Hz
+        const double f0 = 38.13547087602444, q = 0.5003270373238773;
+        auto k = std::tan(juce::MathConstants<double>::pi * f0 / sampleRate);
+        auto a0 = 1.0 + k / q + k * k;
+
+        auto& h = prototype.highpass;
+        h.b0 = 1.0;
+        h.b1 = -2.0;
+        h.b2 = 1.0;
+        h.a1 = 2.0 * (k * k - 1.0) / a0;
+        h.a2 = (1.0 - k / q + k * k) / a0;
+    }
+
+    for (size_t ch = 0; ch < channels.size(); ++ch)
+    {
+        channels[ch] = prototype;
+
+        // L R C LFE Ls Rs: surrounds count +1.5 dB, the LFE not at all
+        if (channels.size() == 6)
+            channels[ch].weight = ch == 3 ? 0.0 : (ch >= 4 ? 1.41 : 1.0);
+        else if (channels.size() == 5)
+            channels[ch].weight = ch >= 3 ? 1.41 : 1.0;
+    }
+
+    subBlockLength = juce::jmax(1, juce::roundToInt(sampleRate * 0.1));
+    reset();
+}
+
+void LoudnessMeter::reset()
+{
+    for (auto& channel : channels)
+    {
+        channel.shelf.z1 = channel.shelf.z2 = 0.0;
+        channel.highpass.z1 = channel.highpass.z2 = 0.0;
+        channel.sumOfSquares = 0.0;
+    }
+
+    subBlockPosition = 0;
+    subBlocks.fill(0.0);
+    subBlockIndex = 0;
+    numSubBlocks = 0;
+
+    momentaryHistogram.clear();
+    shortTermHistogram.clear();
+
+    momentary = shortTerm = integrated = silence;
+    loudnessRange = 0.0f;
+}
+
+void LoudnessMeter::process(const juce::AudioBuffer<float>& buffer, int numSamples) noexcept
+{
+    auto numCh = juce::jmin((int)channels.size(), buffer.getNumChannels());
+    int position = 0;
+
+    while (position < numSamples)
+    {
+        auto numThisTime = juce::jmin(numSamples - position, subBlockLength - subBlockPosition);
+
+        for (int ch = 0; ch < numCh; ++ch)
+        {
+            auto& channel = channels[(size_t)ch];
+            auto* data = buffer.getReadPointer(ch, position);
+            auto sum = channel.sumOfSquares;
+
+            for (int n = 0; n < numThisTime; ++n)
+            {
+                auto y = channel.highpass.process(channel.shelf.process(data[n]));
+                sum += y * y;
+            }
+
+            channel.sumOfSquares = sum;
+        }
+
+        position += numThisTime;
+        subBlockPosition += numThisTime;
+
+        if (subBlockPosition == subBlockLength)
+            finishSubBlock();
+    }
+}
+
+void LoudnessMeter::finishSubBlock() noexcept
+{
+    double power = 0.0;
+    for (auto& channel : channels)
+    {
+        power += channel.weight * channel.sumOfSquares / subBlockLength;
+        channel.sumOfSquares = 0.0;
+    }
+
+    subBlockPosition = 0;
+    subBlocks[(size_t)subBlockIndex] = power;
+    subBlockIndex = (subBlockIndex + 1) % subBlocksPerShortTerm;
+    numSubBlocks = juce::jmin(numSubBlocks + 1, (int)subBlocksPerShortTerm);
+
+    auto averageOfLast = [this](int count)
+    {
+        double sum = 0.0;
+        for (int i = 1; i <= count; ++i)
+            sum += subBlocks[(size_t)((subBlockIndex - i + subBlocksPerShortTerm) % subBlocksPerShortTerm)];
+        return sum / count;
+    };
+
+    // A new 400 ms gating block every 100 ms (75 % overlap)
+    if (numSubBlocks >= subBlocksPerMomentary)
+    {
+        auto blockPower = averageOfLast(subBlocksPerMomentary);
+        auto loudness = powerToLoudness(blockPower);
+        momentary = (float)juce::jmax((double)silence, loudness);
+
+        if (loudness >= absoluteGate)
+        {
+            momentaryHistogram.add(blockPower, loudness);
+            updateIntegrated();
+        }
+    }
+
+    // A new 3 s short-term value every 100 ms
+    if (numSubBlocks >= subBlocksPerShortTerm)
+    {
+        auto blockPower = averageOfLast(subBlocksPerShortTerm);
+        auto loudness = powerToLoudness(blockPower);
+        shortTerm = (float)juce::jmax((double)silence, loudness);
+
+        if (loudness >= absoluteGate)
+        {
+            shortTermHistogram.add(blockPower, loudness);
+            updateLoudnessRange();
+        }
+    }
+}
+
+void LoudnessMeter::updateIntegrated() noexcept
+{
+    auto& h = momentaryHistogram;
+    if (h.total == 0)
+        return;
+
+    double sum = 0.0;
+    for (auto p : h.powers)
+        sum += p;
+
+    auto gateBin = binOf(powerToLoudness(sum / (double)h.total) + integratedRelativeGate);
+
+    double gatedSum = 0.0;
+    uint64_t gatedCount = 0;
+    for (int bin = gateBin; bin < numHistogramBins; ++bin)
+    {
+        gatedSum += h.powers[(size_t)bin];
+        gatedCount += h.counts[(size_t)bin];
+    }
+
+    if (gatedCount > 0)
+        integrated = (float)powerToLoudness(gatedSum / (double)gatedCount);
+}
+
+void LoudnessMeter::updateLoudnessRange() noexcept
+{
+    auto& h = shortTermHistogram;
+    if (h.total == 0)
+        return;
+
+    double sum = 0.0;
+    for (auto p : h.powers)
+        sum += p;
+
+    auto gateBin = binOf(powerToLoudness(sum / (double)h.total) + rangeRelativeGate);
+
+    uint64_t gatedCount = 0;
+    for (int bin = gateBin; bin < numHistogramBins; ++bin)
+        gatedCount += h.counts[(size_t)bin];
+
+    if (gatedCount == 0)
+        return;
+
+    // 10th and 95th percentiles of the gated short-term distribution
+    auto lowTarget = 0.10 * (double)gatedCount;
+    auto highTarget = 0.95 * (double)gatedCount;
+    int lowBin = -1, highBin = -1;
+    uint64_t cumulative = 0;
+
+    for (int bin = gateBin; bin < numHistogramBins; ++bin)
+    {
+        cumulative += h.counts[(size_t)bin];
+        if (lowBin < 0 && (double)cumulative >= lowTarget)
+            lowBin = bin;
+        if ((double)cumulative >= highTarget)
+        {
+            highBin = bin;
+            break;
+        }
+    }
+
+    if (lowBin >= 0 && highBin >= 0)
+        loudnessRange = (float)((highBin - lowBin) * binWidth);
+}
+
+double LoudnessMeter::powerToLoudness(double power) noexcept
+{
+    return power > 0.0 ? -0.691 + FastMath::powerToDecibels((float)power) : (double)silence;
+}
+
+int LoudnessMeter::binOf(double loudness) noexcept
+{
+    return juce::jlimit(0, (int)numHistogramBins - 1, (int)std::floor((loudness - absoluteGate) / binWidth));
+}
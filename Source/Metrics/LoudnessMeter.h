@@ -0,0 +1,95 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// ===============================================================================================================
+// Streaming ITU-R BS.1770-4 / EBU R128 loudness: momentary (400 ms), short-term (3 s), gated integrated
+// loudness and EBU Tech 3342 loudness range.
+//
+// Samples go through the two K-weighting biquads once and are summed into 100 ms sub-blocks, so the 400 ms
+// and 3 s windows advance with 75 % overlap (and better) without re-reading history. Gating uses histograms
+// of 0.1 LU bins instead of keeping every block, so the integrated value and LRA cost the same after an hour
+// as after a second.
+class LoudnessMeter
+{
+public:
+    // Returned until enough audio has been seen
+    static constexpr float silence = -100.0f;
+
+    LoudnessMeter() = default;
+
+    // Allocates, call before processing
+    void prepare(double newSampleRate, int newNumChannels);
+    void reset();
+
+    // Analysis thread: feed every sample exactly once
+    void process(const juce::AudioBuffer<float>& buffer, int numSamples) noexcept;
+
+    float getMomentary() const noexcept { return momentary; }          // LUFS
+    float getShortTerm() const noexcept { return shortTerm; }          // LUFS
+    float getIntegrated() const noexcept { return integrated; }        // LUFS
+    float getLoudnessRange() const noexcept { return loudnessRange; }  // LU
+
+private:
+    enum
+    {
+        subBlocksPerMomentary = 4,   // 400 ms
+        subBlocksPerShortTerm = 30,  // 3 s
+        numHistogramBins = 800       // -70 .. +10 LUFS in 0.1 LU steps
+    };
+
+    struct Biquad
+    {
+        double b0 = 1.0, b1 = 0.0, b2 = 0.0, a1 = 0.0, a2 = 0.0;
+        double z1 = 0.0, z2 = 0.0;
+
+        double process(double x) noexcept
+        {
+            auto y = b0 * x + z1;
+            z1 = b1 * x - a1 * y + z2;
+            z2 = b2 * x - a2 * y;
+            return y;
+        }
+    };
+
+    struct ChannelState
+    {
+        Biquad shelf, highpass;
+        double weight = 1.0;
+        double sumOfSquares = 0.0;
+    };
+
+    struct Histogram
+    {
+        std::array<uint32_t, numHistogramBins> counts{};
+        std::array<double, numHistogramBins> powers{};   // sum of block powers per bin, for the gate means
+        uint64_t total = 0;
+
+        void add(double power, double loudness) noexcept;
+        void clear() noexcept;
+    };
+
+    void finishSubBlock() noexcept;
+    void updateIntegrated() noexcept;
+    void updateLoudnessRange() noexcept;
+
+    static double powerToLoudness(double power) noexcept;
+    static int binOf(double loudness) noexcept;
+
+    double sampleRate = 44100.0;
+    std::vector<ChannelState> channels;
+
+    int subBlockLength = 4410;
+    int subBlockPosition = 0;
+
+    std::array<double, subBlocksPerShortTerm> subBlocks{};   // ring of weighted 100 ms powers
+    int subBlockIndex = 0;
+    int numSubBlocks = 0;
+
+    Histogram momentaryHistogram;   // gating blocks for the integrated loudness
+    Histogram shortTermHistogram;   // short-term values for the loudness range
+
+    float momentary = silence, shortTerm = silence, integrated = silence, loudnessRange = 0.0f;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LoudnessMeter)
+};
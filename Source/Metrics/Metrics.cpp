@@ -1,4 +1,5 @@
 #include "metrics.h"
+#include "FastMath.h"
 #include <juce_dsp/juce_dsp.h>
 #include <numeric>
 #include <complex>
@@ -6,266 +7,662 @@
 
 namespace Metrics
 {
+    namespace
+    {
+        // Independent accumulators per lane: no loop-carried dependency between lanes, so the compiler keeps
+        // each array in one SIMD register and vectorises the inner loops without needing fast-math
+        constexpr int lanes = 8;
+    }
 
     // =============================
     // Frequency-domain metrics
     // =============================
 
-    float computeSpectralCentroid(float* fftData, double sampleRate)
+    float computeSpectralCentroid(const SpectrumFrame& spectrum)
     {
-
-        float numerator = 0.0f, denominator = 0.0f;
-        for (int k = 0; k < fftSize / 2; ++k)
-        {
-            float magnitude = std::abs(fftData[k]);
-            numerator += k * magnitude;
-            denominator += magnitude;
-        }
-
-        if (denominator == 0.0f) return 0.0f;
-        return (numerator / denominator) * (sampleRate / fftSize);
+        auto total = spectrum.getTotalMagnitude();
+        if (total <= 0.0) return 0.0f;
+        return (float)(spectrum.getMagnitudeWeightedFrequency() / total);
     }
 
-    float computeSpectralRolloff(float* fftData, double sampleRate, float rolloffPercent)
+    float computeSpectralRolloff(const SpectrumFrame& spectrum, float rolloffPercent)
     {
-
-        std::vector<float> magnitudes(fftSize / 2);
-        float totalEnergy = 0.0f;
-        for (int k = 0; k < fftSize / 2; ++k)
-        {
-            magnitudes[k] = std::abs(fftData[k]);
-            totalEnergy += magnitudes[k];
-        }
-
-        float threshold = totalEnergy * rolloffPercent;
-        float cumulative = 0.0f;
-        for (int k = 0; k < fftSize / 2; ++k)
-        {
-            cumulative += magnitudes[k];
-            if (cumulative >= threshold)
-                return (float)k * (sampleRate / fftSize);
-        }
-        return 0.0f;
+        if (spectrum.getTotalMagnitude() <= 0.0) return 0.0f;
+        return spectrum.getFrequencies()[spectrum.findCumulativeMagnitudeBin(rolloffPercent)];
     }
 
-    float computeSpectralFlatness(float* fftData)
+    float computeSpectralFlatness(const SpectrumFrame& spectrum)
     {
-        double logSum = 0.0;
-        int N = fftSize / 2;
+        // Geometric and arithmetic means in the same pass: log2 and linear sums side by side, per lane
+        auto* magnitude = spectrum.getMagnitude();
+        int N = spectrum.getNumBins();
+
+        float logAcc[lanes] = {}, linAcc[lanes] = {};
+        int k = 0;
+        for (; k + lanes <= N; k += lanes)
+            for (int i = 0; i < lanes; ++i)
+            {
+                auto mag = magnitude[k + i] + 1e-12f; // avoid log(0)
+                logAcc[i] += FastMath::log2(mag);
+                linAcc[i] += mag;
+            }
 
-        for (int k = 0; k < N; ++k)
+        for (; k < N; ++k)
         {
-            float mag = std::abs(fftData[k]) + 1e-12f; // avoid log(0)
-            logSum += std::log(mag);
+            auto mag = magnitude[k] + 1e-12f;
+            logAcc[0] += FastMath::log2(mag);
+            linAcc[0] += mag;
         }
 
-        double geoMean = std::exp(logSum / N);
-
-        double arithMean = 0.0;
-        for (int k = 0; k < N; ++k)
+        double logSum = 0.0, linSum = 0.0;
+        for (int i = 0; i < lanes; ++i)
         {
-            float mag = std::abs(fftData[k]) + 1e-12f;
-            arithMean += mag;
+            logSum += logAcc[i];
+            linSum += linAcc[i];
         }
-        arithMean /= N;
+
+        double geoMean = FastMath::exp2((float)(logSum / N));
+        double arithMean = linSum / N;
 
         return arithMean > 0.0 ? static_cast<float>(geoMean / arithMean) : 0.0f;
     }
 
 
-    std::array<float, 3> computeBandEnergy(float* fftData, double sampleRate)
+    std::array<float, 3> computeBandEnergy(const SpectrumFrame& spectrum)
     {
-
-        return {};
+        // Low < 250 Hz <= mid < 4 kHz <= high
+        auto lowEnd = spectrum.binForFrequency(250.0);
+        auto midEnd = spectrum.binForFrequency(4000.0);
+        auto numBins = spectrum.getNumBins();
+
+        return { (float)spectrum.getPowerSum(0, lowEnd),
+                 (float)spectrum.getPowerSum(lowEnd, midEnd),
+                 (float)spectrum.getPowerSum(midEnd, numBins) };
     }
 
-    float computeResonanceScore(float* fftData, double sampleRate)
+    float computeResonanceScore(const SpectrumFrame& spectrum)
     {
-
-        float maxPeak = 0.0f, avg = 0.0f;
-        for (int k = 0; k < fftSize / 2; ++k)
-        {
-            float mag = std::abs(fftData[k]);
-            maxPeak = std::max(maxPeak, mag);
-            avg += mag;
-        }
-        avg /= (fftSize / 2);
+        float maxPeak = spectrum.getMagnitude()[spectrum.getPeakBin()];
+        float avg = (float)(spectrum.getTotalMagnitude() / spectrum.getNumBins());
         return avg > 0.0f ? maxPeak / avg : 0.0f;
     }
 
-    juce::Array<float> computeTonalBalance(const juce::AudioBuffer<float>& buffer, double sampleRate)
+    ScratchArray<float> computeBandPowers(const SpectrumFrame& spectrum, const Filterbank& bands, AnalysisContext& context)
     {
+        auto bandPower = context.allocate<float>(bands.getNumBands());
+        if (!bandPower.isEmpty())
+            bands.apply(spectrum.getPower(), bandPower.data);
+        return bandPower;
+    }
+
+    ScratchArray<float> computeTonalBalance(const SpectrumFrame& spectrum, AnalysisContext& context)
+    {
+        // Third-octave levels relative to the whole spectrum, so the shape doesn't move with the level
+        auto balance = computeBandPowers(spectrum, context.getThirdOctaveBands(), context);
+        auto total = (float)spectrum.getTotalPower() + 1e-20f;
 
-        return 0;
+        for (auto& band : balance)
+            band = FastMath::powerToDecibels((band + 1e-20f) / total);
+        return balance;
     }
 
-    float computeHarmonicToNoiseRatio(float* fftData, double sampleRate)
+    PitchEstimate computePitch(const float* autocorrelation, int numLags, double sampleRate, float minHz, float maxHz)
     {
-        // Simplified version: compare strongest harmonic peak to average noise floor
-        float maxPeak = 0.0f, noiseSum = 0.0f;
-        int N = fftSize / 2;
+        PitchEstimate estimate;
+
+        int minLag = juce::jmax(2, (int)std::floor(sampleRate / maxHz));
+        int maxLag = juce::jmin(numLags - 2, (int)std::ceil(sampleRate / minHz));
+        if (maxLag <= minLag)
+            return estimate;
+
+        // d(tau) = 2 (r[0] - r[tau]), normalised by its running mean. Only three consecutive values are needed
+        // at a time, so nothing is stored.
+        constexpr float threshold = 0.15f;
+        double runningSum = 0.0;
+        auto cmnd = [&](int lag)
+        {
+            auto d = 2.0f * (1.0f - autocorrelation[lag]);
+            runningSum += d;
+            return runningSum > 0.0 ? (float)(d * lag / runningSum) : 1.0f;
+        };
+
+        for (int lag = 1; lag < minLag - 1; ++lag)
+            cmnd(lag);
+
+        auto previous = cmnd(minLag - 1);
+        auto current = cmnd(minLag);
+        int bestLag = -1;
+        float best = 1.0f, bestPrevious = 1.0f, bestNext = 1.0f;
 
-        for (int k = 1; k < N; ++k)
+        for (int lag = minLag; lag < maxLag; ++lag)
         {
-            float mag = std::abs(fftData[k]);
-            maxPeak = std::max(maxPeak, mag);
-            noiseSum += mag;
+            auto next = cmnd(lag + 1);
+            auto isDip = current <= previous && current <= next;
+
+            // First dip under the threshold wins; otherwise the deepest dip seen (YIN's fallback)
+            if (isDip && (current < threshold || current < best))
+            {
+                bestLag = lag;
+                best = current;
+                bestPrevious = previous;
+                bestNext = next;
+
+                if (current < threshold)
+                    break;
+            }
+
+            previous = current;
+            current = next;
         }
-        float noiseAvg = (noiseSum - maxPeak) / (N - 1);
 
-        return noiseAvg > 0.0f ? maxPeak / noiseAvg : 0.0f;
+        if (bestLag < 0)
+            return estimate;
+
+        auto denominator = bestPrevious - 2.0f * best + bestNext;
+        auto offset = denominator > 0.0f ? 0.5f * (bestPrevious - bestNext) / denominator : 0.0f;
+        auto lag = bestLag + offset;
+
+        estimate.f0Hz = (float)(sampleRate / lag);
+        estimate.confidence = juce::jlimit(0.0f, 1.0f, 1.0f - best);
+
+        // Periodicity from the autocorrelation itself, interpolated at the refined lag
+        auto base = (int)std::floor(lag);
+        auto fraction = lag - (float)base;
+        estimate.periodicity = autocorrelation[base] + fraction * (autocorrelation[base + 1] - autocorrelation[base]);
+        return estimate;
+    }
+
+    float computeHarmonicToNoiseRatio(float periodicity)
+    {
+        auto r = juce::jlimit(1e-6f, 1.0f - 1e-6f, periodicity);
+        return juce::jlimit(-60.0f, 60.0f, FastMath::powerToDecibels(r / (1.0f - r)));
     }
 
     // =============================
     // Time-domain metrics
     // =============================
 
-    float computeRMS(const juce::AudioBuffer<float>& buffer)
+    TimeDomainStats computeTimeDomainStats(const juce::AudioBuffer<float>& buffer)
     {
-        double sumSquares = 0.0;
-        int totalSamples = 0;
+        TimeDomainStats stats;
+        stats.numChannels = buffer.getNumChannels();
+        stats.numSamples = buffer.getNumSamples();
+
+        const int N = stats.numSamples;
+        if (stats.numChannels == 0 || N == 0)
+            return stats;
+
+        const float* L = buffer.getReadPointer(0);
+        const float* R = stats.numChannels > 1 ? buffer.getReadPointer(1) : nullptr;
+
+        float l2[lanes] = {}, r2[lanes] = {}, lr[lanes] = {}, peak[lanes] = {}, delta[lanes] = {};
 
-        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+        auto stereoStep = [&](int n, int lane)
+        {
+            auto l = L[n], r = R[n];
+            l2[lane] += l * l;
+            r2[lane] += r * r;
+            lr[lane] += l * r;
+            peak[lane] = std::max(peak[lane], std::max(std::abs(l), std::abs(r)));
+        };
+
+        auto monoStep = [&](int n, int lane)
+        {
+            auto l = L[n];
+            l2[lane] += l * l;
+            peak[lane] = std::max(peak[lane], std::abs(l));
+        };
+
+        // Sample 0 has no predecessor for the delta
+        if (R != nullptr) stereoStep(0, 0); else monoStep(0, 0);
+
+        int n = 1;
+        if (R != nullptr)
+        {
+            for (; n + lanes <= N; n += lanes)
+                for (int i = 0; i < lanes; ++i)
+                {
+                    stereoStep(n + i, i);
+                    delta[i] = std::max(delta[i], std::abs(L[n + i] - L[n + i - 1]));
+                }
+
+            for (; n < N; ++n)
+            {
+                stereoStep(n, 0);
+                delta[0] = std::max(delta[0], std::abs(L[n] - L[n - 1]));
+            }
+        }
+        else
+        {
+            for (; n + lanes <= N; n += lanes)
+                for (int i = 0; i < lanes; ++i)
+                {
+                    monoStep(n + i, i);
+                    delta[i] = std::max(delta[i], std::abs(L[n + i] - L[n + i - 1]));
+                }
+
+            for (; n < N; ++n)
+            {
+                monoStep(n, 0);
+                delta[0] = std::max(delta[0], std::abs(L[n] - L[n - 1]));
+            }
+        }
+
+        // Any further channels only contribute energy and peak
+        float rest[lanes] = {};
+        for (int ch = 2; ch < stats.numChannels; ++ch)
         {
             auto* data = buffer.getReadPointer(ch);
-            for (int n = 0; n < buffer.getNumSamples(); ++n)
+            int k = 0;
+            for (; k + lanes <= N; k += lanes)
+                for (int i = 0; i < lanes; ++i)
+                {
+                    rest[i] += data[k + i] * data[k + i];
+                    peak[i] = std::max(peak[i], std::abs(data[k + i]));
+                }
+
+            for (; k < N; ++k)
             {
-                sumSquares += data[n] * data[n];
-                ++totalSamples;
+                rest[0] += data[k] * data[k];
+                peak[0] = std::max(peak[0], std::abs(data[k]));
             }
         }
 
-        return totalSamples > 0 ? std::sqrt(sumSquares / totalSamples) : 0.0f;
+        double sumRest = 0.0;
+        for (int i = 0; i < lanes; ++i)
+        {
+            stats.sumL2 += l2[i];
+            stats.sumR2 += r2[i];
+            stats.sumLR += lr[i];
+            sumRest += rest[i];
+            stats.peak = std::max(stats.peak, peak[i]);
+            stats.maxDelta = std::max(stats.maxDelta, delta[i]);
+        }
+
+        stats.sumOfSquares = stats.sumL2 + stats.sumR2 + sumRest;
+        return stats;
+    }
+
+    float TimeDomainStats::getRMS() const noexcept
+    {
+        auto totalSamples = (double)numChannels * (double)numSamples;
+        return totalSamples > 0 ? (float)std::sqrt(sumOfSquares / totalSamples) : 0.0f;
+    }
+
+    float TimeDomainStats::getCrestFactor() const noexcept
+    {
+        auto rms = getRMS();
+        return rms > 0.0f ? peak / rms : 0.0f;
+    }
+
+    float TimeDomainStats::getStereoCorrelation() const noexcept
+    {
+        if (numChannels < 2) return 1.0f;
+        return (float)(sumLR / (std::sqrt(sumL2) * std::sqrt(sumR2) + 1e-12));
+    }
+
+    float computeRMS(const juce::AudioBuffer<float>& buffer)
+    {
+        return computeTimeDomainStats(buffer).getRMS();
     }
 
     float computeLUFS(const juce::AudioBuffer<float>& buffer, double sampleRate)
     {
-        // Placeholder: A proper LUFS implementation requires gating & weighting filters
+        // Single-block approximation without K-weighting or gating, the analysis thread uses LoudnessMeter
         return juce::Decibels::gainToDecibels(computeRMS(buffer));
     }
 
     float computePeakLevel(const juce::AudioBuffer<float>& buffer)
     {
-        float peak = 0.0f;
-        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
-        {
-            auto* data = buffer.getReadPointer(ch);
-            for (int n = 0; n < buffer.getNumSamples(); ++n)
-                peak = std::max(peak, std::abs(data[n]));
-        }
-        return peak;
+        return computeTimeDomainStats(buffer).peak;
     }
 
     float computeCrestFactor(const juce::AudioBuffer<float>& buffer)
     {
-        float peak = computePeakLevel(buffer);
-        float rms = computeRMS(buffer);
-        return rms > 0.0f ? peak / rms : 0.0f;
+        return computeTimeDomainStats(buffer).getCrestFactor();
     }
 
     float computeTransientSharpness(const juce::AudioBuffer<float>& buffer, double sampleRate)
     {
         // Approx: ratio of maximum sample difference
-        float maxDelta = 0.0f;
-        auto* data = buffer.getReadPointer(0);
+        return computeTimeDomainStats(buffer).maxDelta;
+    }
+
+    float computeDecayTime(const juce::AudioBuffer<float>& impulseResponse, AnalysisContext& context)
+    {
+        AnalysisContext::ScopedMark scratch(context);
 
-        for (int n = 1; n < buffer.getNumSamples(); ++n)
-            maxDelta = std::max(maxDelta, std::abs(data[n] - data[n - 1]));
+        int N = impulseResponse.getNumSamples();
+        auto energy = context.allocateCleared<float>(N);
+        auto curve = context.allocate<float>(N);
+        if (curve.isEmpty())
+            return 0.0f;
 
-        return maxDelta;
+        for (int ch = 0; ch < impulseResponse.getNumChannels(); ++ch)
+        {
+            auto* data = impulseResponse.getReadPointer(ch);
+            for (int n = 0; n < N; ++n)
+                energy[n] += data[n] * data[n];
+        }
+
+        computeEnergyDecayCurve(energy.data, N, 0.0f, N, curve.data);
+        auto truncationDb = computeTruncationLevel(energy.data, N, 0.0f, context.getSampleRate());
+
+        auto t30 = computeDecayFit(curve.data, N, context.getSampleRate(), -5.0f, -35.0f, truncationDb);
+        return t30 > 0.0f ? t30 : computeDecayFit(curve.data, N, context.getSampleRate(), -5.0f, -25.0f, truncationDb);
     }
 
-    float computeDecayTime(const juce::AudioBuffer<float>& buffer, double sampleRate)
+    void computeEnergyDecayCurve(const float* energy, int numSamples, float noiseEnergy, int truncation, float* curveDb)
     {
-        // Rough estimate: time it takes RMS to drop by 60 dB
-        float rmsStart = computeRMS(buffer);
-        if (rmsStart <= 0.0f) return 0.0f;
+        truncation = juce::jlimit(0, numSamples, truncation);
 
-        auto* data = buffer.getReadPointer(0);
-        int N = buffer.getNumSamples();
-        for (int n = 0; n < N; ++n)
+        // Backward cumulative sums, in place in the output
+        double sum = 0.0;
+        for (int n = truncation; --n >= 0;)
         {
-            float windowRMS = std::abs(data[n]);
-            if (juce::Decibels::gainToDecibels(windowRMS / rmsStart) <= -60.0f)
-                return (float)n / sampleRate;
+            sum += juce::jmax(0.0f, energy[n] - noiseEnergy);
+            curveDb[n] = (float)sum;
         }
-        return (float)N / sampleRate;
+
+        auto total = sum;
+        auto scale = total > 0.0 ? (float)(1.0 / total) : 0.0f;
+        for (int n = 0; n < truncation; ++n)
+            curveDb[n] = curveDb[n] > 0.0f ? FastMath::powerToDecibels(curveDb[n] * scale) : -200.0f;
+
+        std::fill(curveDb + truncation, curveDb + numSamples, -200.0f);
     }
 
-    juce::Array<float> computeEnvelope(const juce::AudioBuffer<float>& buffer, double sampleRate)
+    float computeTruncationLevel(const float* energy, int truncation, float noiseEnergy, double sampleRate)
     {
-        juce::Array<float> env;
-        int hopSize = (int)(sampleRate * 0.01); // 10 ms
-        for (int n = 0; n < buffer.getNumSamples(); n += hopSize)
+        auto blockLength = juce::jmax(1, (int)(sampleRate * 0.01));
+        if (truncation < blockLength)
+            return 0.0f;
+
+        auto blockMean = [&](int start)
         {
-            float rms = 0.0f;
-            int count = 0;
-            for (int i = 0; i < hopSize && (n + i) < buffer.getNumSamples(); ++i)
-            {
-                float sample = buffer.getSample(0, n + i);
-                rms += sample * sample;
-                ++count;
-            }
-            env.add(count > 0 ? std::sqrt(rms / count) : 0.0f);
+            double sum = 0.0;
+            for (int n = start; n < start + blockLength; ++n)
+                sum += energy[n];
+            return juce::jmax(0.0, sum / blockLength - noiseEnergy);
+        };
+
+        double loudest = 0.0;
+        for (int block = 0; block + blockLength <= truncation; block += blockLength)
+            loudest = juce::jmax(loudest, blockMean(block));
+
+        auto last = blockMean(truncation - blockLength);
+        if (loudest <= 0.0 || last <= 0.0)
+            return last > 0.0 ? 0.0f : -200.0f;
+
+        return FastMath::powerToDecibels((float)(last / loudest));
+    }
+
+    float computeDecayFit(const float* curveDb, int numSamples, double sampleRate, float startDb, float endDb,
+                          float truncationDb)
+    {
+        // Near the truncation the curve drops towards -inf, a fit reaching into that only measures the drop
+        if (endDb < truncationDb + 10.0f)
+            return 0.0f;
+
+        int first = 0;
+        while (first < numSamples && curveDb[first] > startDb)
+            ++first;
+
+        int last = first;
+        while (last < numSamples && curveDb[last] > endDb)
+            ++last;
+
+        if (last >= numSamples || last - first < 2)
+            return 0.0f;
+
+        // Regression of level against sample index. With x centred the intercept drops out of the slope.
+        auto centre = 0.5 * (first + last);
+        double sumXY = 0.0, sumXX = 0.0;
+        for (int n = first; n <= last; ++n)
+        {
+            auto x = n - centre;
+            sumXY += x * curveDb[n];
+            sumXX += x * x;
         }
-        return env;
+
+        auto slopePerSample = sumXY / sumXX;    // dB per sample
+        return slopePerSample < 0.0 ? (float)(-60.0 / (slopePerSample * sampleRate)) : 0.0f;
     }
 
-    float computeStereoCorrelation(const juce::AudioBuffer<float>& buffer)
+    ScratchArray<float> computeEnvelope(const juce::AudioBuffer<float>& buffer, AnalysisContext& context)
     {
-        if (buffer.getNumChannels() < 2) return 1.0f;
+        int numSamples = buffer.getNumSamples();
+        int hopSize = juce::jmax(1, (int)(context.getSampleRate() * 0.01)); // 10 ms
+        if (buffer.getNumChannels() == 0 || numSamples == 0)
+            return {};
 
-        auto* L = buffer.getReadPointer(0);
-        auto* R = buffer.getReadPointer(1);
-        int N = buffer.getNumSamples();
+        auto env = context.allocate<float>((numSamples + hopSize - 1) / hopSize);
+        auto* data = buffer.getReadPointer(0);
 
-        double sumLR = 0, sumL2 = 0, sumR2 = 0;
-        for (int n = 0; n < N; ++n)
+        for (int i = 0; i < env.size; ++i)
         {
-            sumLR += L[n] * R[n];
-            sumL2 += L[n] * L[n];
-            sumR2 += R[n] * R[n];
+            int start = i * hopSize;
+            int count = juce::jmin(hopSize, numSamples - start);
+
+            float sum = 0.0f;
+            for (int n = start; n < start + count; ++n)
+                sum += data[n] * data[n];
+
+            env[i] = std::sqrt(sum / count);
         }
+        return env;
+    }
 
-        return (float)(sumLR / (std::sqrt(sumL2) * std::sqrt(sumR2) + 1e-12));
+    float computeStereoCorrelation(const juce::AudioBuffer<float>& buffer)
+    {
+        return computeTimeDomainStats(buffer).getStereoCorrelation();
     }
 
     // =============================
     // Cross-domain metrics
     // =============================
 
-    float computeTHD(const juce::AudioBuffer<float>& buffer, double sampleRate)
+    float HarmonicAnalysis::getTHD() const noexcept
     {
-        // Placeholder: proper THD needs fundamental detection & harmonic energy sum
-        return 0.0f;
+        return fundamentalPower > 0.0 ? (float)std::sqrt(harmonicPower / fundamentalPower) : 0.0f;
     }
 
-    float computeIntermodulationDistortion(const juce::AudioBuffer<float>& buffer, double sampleRate)
+    float HarmonicAnalysis::getTHDPlusNoise() const noexcept
     {
-        // Placeholder
-        return 0.0f;
+        return fundamentalPower > 0.0 ? (float)std::sqrt(juce::jmax(0.0, totalPower - fundamentalPower) / fundamentalPower) : 0.0f;
+    }
+
+    HarmonicAnalysis computeHarmonics(const SpectrumFrame& spectrum, int lobeBins)
+    {
+        HarmonicAnalysis result;
+
+        auto* magnitude = spectrum.getMagnitude();
+        int N = spectrum.getNumBins();
+        int peak = spectrum.getPeakBin();
+        if (N < 3 || magnitude[peak] <= 0.0f)
+            return result;
+
+        auto lobePower = [&](int centre)
+        {
+            return spectrum.getPowerSum(juce::jmax(0, centre - lobeBins), juce::jmin(N, centre + lobeBins + 1));
+        };
+
+        // Sub-bin position of the fundamental: parabola through the log magnitudes around the peak
+        double position = peak;
+        if (peak + 1 < N)
+        {
+            auto a = FastMath::log2(magnitude[peak - 1] + 1e-20f);
+            auto b = FastMath::log2(magnitude[peak]);
+            auto c = FastMath::log2(magnitude[peak + 1] + 1e-20f);
+            auto denominator = a - 2.0f * b + c;
+            if (denominator < 0.0f)
+                position += 0.5 * (a - c) / denominator;
+        }
+
+        result.fundamentalHz = (float)(position * spectrum.getBinWidth());
+        result.fundamentalPower = lobePower(peak);
+        result.totalPower = spectrum.getPowerSum(lobeBins + 1, N);
+
+        // Below this the harmonic lobes overlap the fundamental's and can't be told apart
+        if (position < 2 * lobeBins + 1)
+            return result;
+
+        result.resolved = true;
+
+        for (int h = 2;; ++h)
+        {
+            auto expected = juce::roundToInt(h * position);
+            if (expected + lobeBins >= N)
+                break;
+
+            // The harmonic's own peak within a couple of bins of h * f0
+            int centre = expected;
+            for (int k = juce::jmax(1, expected - 2); k <= juce::jmin(N - 1, expected + 2); ++k)
+                if (magnitude[k] > magnitude[centre])
+                    centre = k;
+
+            auto power = lobePower(centre);
+            result.harmonicPower += power;
+
+            if (h - 2 < HarmonicAnalysis::maxHarmonics)
+                result.harmonics[(size_t)(h - 2)] = power;
+        }
+
+        return result;
     }
 
-    juce::Array<float> computeSpectralDynamics(const juce::AudioBuffer<float>& buffer, double sampleRate)
+    float computeTHD(const SpectrumFrame& spectrum, int lobeBins)
     {
-        // Placeholder: could return per-band RMS over time
-        return {};
+        return computeHarmonics(spectrum, lobeBins).getTHD();
     }
 
-    float computeModulationDepth(const juce::AudioBuffer<float>& buffer)
+    float computeIntermodulationDistortion(const SpectrumFrame& spectrum, int referenceBinA, int referenceBinB,
+                                           const IntermodulationGroup* groups, int numGroups)
     {
-        // Placeholder: ratio of max-min envelope
-        auto env = computeEnvelope(buffer, 44100.0);
-        if (env.isEmpty()) return 0.0f;
+        auto* magnitude = spectrum.getMagnitude();
+        auto reference = magnitude[referenceBinA] + (referenceBinB >= 0 ? magnitude[referenceBinB] : 0.0f);
+        if (reference <= 0.0f)
+            return 0.0f;
 
-        float maxEnv = *std::max_element(env.begin(), env.end());
-        float minEnv = *std::min_element(env.begin(), env.end());
-        return maxEnv - minEnv;
+        float sum = 0.0f;
+        for (int g = 0; g < numGroups; ++g)
+        {
+            auto amplitude = magnitude[groups[g].lowerBin] + (groups[g].upperBin >= 0 ? magnitude[groups[g].upperBin] : 0.0f);
+            sum += amplitude * amplitude;
+        }
+
+        return std::sqrt(sum) / reference;
+    }
+
+    ScratchArray<float> computeSpectralDynamics(const SpectrumFrame& spectrum, const Filterbank& bands,
+                                                float meanSquareScale, AnalysisContext& context)
+    {
+        auto levels = computeBandPowers(spectrum, bands, context);
+        for (auto& level : levels)
+            level = FastMath::powerToDecibels(level * meanSquareScale + 1e-20f);    // -200 dB floor
+        return levels;
     }
 
-    float computeModulationRate(const juce::AudioBuffer<float>& buffer, double sampleRate)
+    float computeModulationDepth(const juce::AudioBuffer<float>& buffer, AnalysisContext& context)
     {
-        // Placeholder: would require FFT of envelope
+        AnalysisContext::ScopedMark scratch(context);
+        auto env = computeEnvelope(buffer, context);
+        return computeModulationDepth(env.data, env.size);
+    }
+
+    float computeModulationRate(const juce::AudioBuffer<float>& buffer, AnalysisContext& context)
+    {
+        // A single frame holds few envelope values, so this only resolves fast modulation
+        AnalysisContext::ScopedMark scratch(context);
+        auto env = computeEnvelope(buffer, context);
+        return computeModulationRate(env.data, env.size, 100.0);   // computeEnvelope hops 10 ms
+    }
+
+    float computeModulationDepth(const float* envelope, int numValues)
+    {
+        if (numValues < 2)
+            return 0.0f;
+
+        double sum = 0.0, sumOfSquares = 0.0;
+        for (int n = 0; n < numValues; ++n)
+        {
+            sum += envelope[n];
+            sumOfSquares += (double)envelope[n] * envelope[n];
+        }
+
+        auto mean = sum / numValues;
+        if (mean <= 1e-6)
+            return 0.0f;
+
+        auto variance = juce::jmax(0.0, sumOfSquares / numValues - mean * mean);
+        return (float)(juce::MathConstants<double>::sqrt2 * std::sqrt(variance) / mean);
+    }
+
+    float computeModulationRate(const float* envelope, int numValues, double envelopeRate,
+                                float minRateHz, float maxRateHz)
+    {
+        if (numValues < 4)
+            return 0.0f;
+
+        double sum = 0.0;
+        for (int n = 0; n < numValues; ++n)
+            sum += envelope[n];
+        auto mean = (float)(sum / numValues);
+
+        // Unbiased autocorrelation of the mean-removed envelope, normalised to lag 0
+        auto autocorrelation = [&](int lag)
+        {
+            int count = numValues - lag;
+            float acc[lanes] = {};
+            int n = 0;
+            for (; n + lanes <= count; n += lanes)
+                for (int i = 0; i < lanes; ++i)
+                    acc[i] += (envelope[n + i] - mean) * (envelope[n + lag + i] - mean);
+
+            for (; n < count; ++n)
+                acc[0] += (envelope[n] - mean) * (envelope[n + lag] - mean);
+
+            float total = 0.0f;
+            for (auto a : acc)
+                total += a;
+            return total / count;
+        };
+
+        auto r0 = autocorrelation(0);
+        if (r0 <= 1e-12f * mean * mean + 1e-20f)
+            return 0.0f;
+
+        // Two periods must fit for the peak to mean anything
+        int minLag = juce::jmax(1, (int)std::floor(envelopeRate / maxRateHz));
+        int maxLag = juce::jmin(numValues / 2, (int)std::ceil(envelopeRate / minRateHz));
+        if (maxLag < minLag + 2)
+            return 0.0f;
+
+        constexpr float threshold = 0.3f;
+        bool crossedZero = false;
+        float previous = 1.0f;
+        float current = autocorrelation(1) / r0;
+
+        // First local maximum after the first zero crossing, so a period is never mistaken for two
+        for (int lag = 1; lag < maxLag; ++lag)
+        {
+            auto next = autocorrelation(lag + 1) / r0;
+            crossedZero = crossedZero || current < 0.0f;
+
+            if (crossedZero && current > threshold && current >= previous && current >= next)
+            {
+                if (lag < minLag)
+                    return 0.0f;    // faster than maxRateHz
+
+                auto denominator = previous - 2.0f * current + next;
+                auto offset = denominator < 0.0f ? 0.5f * (previous - next) / denominator : 0.0f;
+                return (float)(envelopeRate / (lag + offset));
+            }
+
+            previous = current;
+            current = next;
+        }
+
         return 0.0f;
     }
 }
@@ -1,46 +1,133 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "SpectrumFrame.h"
+#include "AnalysisContext.h"
 
-// Namespace to avoid clutter
+// Namespace to avoid clutter.
+// Metrics that need temporary arrays take them from an AnalysisContext and return views into it, so
+// nothing here allocates; those views are valid until the context's next beginFrame().
 namespace Metrics
 {
     // =============================
     // Frequency-domain metrics
     // =============================
-    float computeSpectralCentroid(float* fftData, double sampleRate);
-    float computeSpectralRolloff(float* fftData, double sampleRate, float rolloffPercent = 0.95f);
-    float computeSpectralFlatness(float* fftData);
-    std::array<float, 3> computeBandEnergy(float* fftData, double sampleRate); // low, mid, high
-    float computeResonanceScore(float* fftData, double sampleRate);
-    juce::Array<float> computeTonalBalance(const juce::AudioBuffer<float>& buffer, double sampleRate);
-    float computeHarmonicToNoiseRatio(float* fftData, double sampleRate);
+    float computeSpectralCentroid(const SpectrumFrame& spectrum);
+    float computeSpectralRolloff(const SpectrumFrame& spectrum, float rolloffPercent = 0.95f);
+    float computeSpectralFlatness(const SpectrumFrame& spectrum);
+    std::array<float, 3> computeBandEnergy(const SpectrumFrame& spectrum); // low, mid, high
+    float computeResonanceScore(const SpectrumFrame& spectrum);
+    ScratchArray<float> computeBandPowers(const SpectrumFrame& spectrum, const Filterbank& bands, AnalysisContext& context);
+    ScratchArray<float> computeTonalBalance(const SpectrumFrame& spectrum, AnalysisContext& context); // 1/3 octaves, dB re. total
+
+    // YIN on a normalised autocorrelation (r[0] = 1, lags 0 .. numLags - 1), as PitchMeter gets it from the
+    // power spectrum. The cumulative-mean-normalised difference is formed from r on the fly.
+    struct PitchEstimate
+    {
+        float f0Hz = 0.0f;          // 0 if no period in range
+        float confidence = 0.0f;    // 1 - CMND at the chosen lag, 0 .. 1
+        float periodicity = 0.0f;   // normalised autocorrelation at that lag
+    };
+
+    PitchEstimate computePitch(const float* autocorrelation, int numLags, double sampleRate,
+                               float minHz = 50.0f, float maxHz = 2000.0f);
+
+    // Boersma's HNR from the periodicity r: 10 log10(r / (1 - r)), clamped to +-60 dB
+    float computeHarmonicToNoiseRatio(float periodicity);
 
     // =============================
     // Time-domain metrics
     // =============================
+    // Everything the time-domain metrics need, gathered in one pass over each channel
+    struct TimeDomainStats
+    {
+        int numChannels = 0;
+        int numSamples = 0;
+        double sumOfSquares = 0.0;      // all channels
+        float peak = 0.0f;              // all channels
+        float maxDelta = 0.0f;          // channel 0, largest sample to sample step
+        double sumLR = 0.0, sumL2 = 0.0, sumR2 = 0.0;   // channels 0 and 1
+
+        float getRMS() const noexcept;
+        float getCrestFactor() const noexcept;
+        float getStereoCorrelation() const noexcept;
+    };
+
+    TimeDomainStats computeTimeDomainStats(const juce::AudioBuffer<float>& buffer);
+
     float computeRMS(const juce::AudioBuffer<float>& buffer);
     float computeLUFS(const juce::AudioBuffer<float>& buffer, double sampleRate);
     float computePeakLevel(const juce::AudioBuffer<float>& buffer);
     float computeCrestFactor(const juce::AudioBuffer<float>& buffer);
     float computeTransientSharpness(const juce::AudioBuffer<float>& buffer, double sampleRate);
-    float computeDecayTime(const juce::AudioBuffer<float>& buffer, double sampleRate);
-    juce::Array<float> computeEnvelope(const juce::AudioBuffer<float>& buffer, double sampleRate);
+    // RT60 (from T30, or T20 if the decay doesn't reach -35 dB) of an impulse response starting at its onset
+    float computeDecayTime(const juce::AudioBuffer<float>& impulseResponse, AnalysisContext& context);
+
+    // Schroeder backward integration of per-sample energy, in dB re. the total, into curveDb (numSamples).
+    // noiseEnergy is subtracted from every sample and integration stops at truncation (ISO 3382-1, method B),
+    // so a noise floor doesn't bend the end of the curve. Below truncation the curve reads -200 dB.
+    void computeEnergyDecayCurve(const float* energy, int numSamples, float noiseEnergy, int truncation, float* curveDb);
+
+    // Level of the decay where the curve was truncated, in dB re. its loudest 10 ms, with noiseEnergy removed.
+    // The Schroeder curve falls away towards the truncation whatever the decay does, so fits must stop short of it.
+    float computeTruncationLevel(const float* energy, int truncation, float noiseEnergy, double sampleRate);
+
+    // Least-squares slope of the curve between startDb and endDb, as the time to decay 60 dB.
+    // 0 if the curve never gets to endDb, or if endDb is less than 10 dB above truncationDb.
+    float computeDecayFit(const float* curveDb, int numSamples, double sampleRate, float startDb, float endDb,
+                          float truncationDb);
+    ScratchArray<float> computeEnvelope(const juce::AudioBuffer<float>& buffer, AnalysisContext& context); // 10 ms RMS
     float computeStereoCorrelation(const juce::AudioBuffer<float>& buffer);
 
     // =============================
     // Cross-domain metrics
     // =============================
-    float computeTHD(const juce::AudioBuffer<float>& buffer, double sampleRate);
-    float computeIntermodulationDistortion(const juce::AudioBuffer<float>& buffer, double sampleRate);
-    juce::Array<float> computeSpectralDynamics(const juce::AudioBuffer<float>& buffer, double sampleRate);
-    float computeModulationDepth(const juce::AudioBuffer<float>& buffer);
-    float computeModulationRate(const juce::AudioBuffer<float>& buffer, double sampleRate);
+    // Fundamental and harmonics of a single-tone spectrum. lobeBins is the half width of the analysis window's
+    // main lobe in bins: each tone's power is summed over +-lobeBins around its peak.
+    struct HarmonicAnalysis
+    {
+        enum { maxHarmonics = 16 };     // reported one by one (2nd .. 17th), THD sums every harmonic below Nyquist
+
+        bool resolved = false;          // false if the fundamental is too low for its harmonics to be told apart
+        float fundamentalHz = 0.0f;
+        double fundamentalPower = 0.0;
+        double harmonicPower = 0.0;     // all harmonics
+        double totalPower = 0.0;        // everything but the DC lobe
+        std::array<double, maxHarmonics> harmonics{};   // power of harmonic h at [h - 2]
+
+        float getTHD() const noexcept;             // sqrt(harmonics / fundamental), as a ratio
+        float getTHDPlusNoise() const noexcept;    // sqrt((total - fundamental) / fundamental)
+    };
+
+    HarmonicAnalysis computeHarmonics(const SpectrumFrame& spectrum, int lobeBins);
+    float computeTHD(const SpectrumFrame& spectrum, int lobeBins);
+    // Products of one order: amplitudes of the two bins are summed, orders are then summed in power.
+    // upperBin is -1 for an order with a single product.
+    struct IntermodulationGroup
+    {
+        int lowerBin = -1, upperBin = -1;
+    };
+
+    // Ratio of the products to the reference tone(s), referenceBinB is -1 for a single reference
+    float computeIntermodulationDistortion(const SpectrumFrame& spectrum, int referenceBinA, int referenceBinB,
+                                           const IntermodulationGroup* groups, int numGroups);
+    // One frame of per-band RMS levels in dB, as SpectralDynamics stores them. meanSquareScale turns spectral
+    // power into mean square for the window used (2 / (fftSize * sum of w^2)).
+    ScratchArray<float> computeSpectralDynamics(const SpectrumFrame& spectrum, const Filterbank& bands,
+                                                float meanSquareScale, AnalysisContext& context);
+    float computeModulationDepth(const juce::AudioBuffer<float>& buffer, AnalysisContext& context);
+    float computeModulationRate(const juce::AudioBuffer<float>& buffer, AnalysisContext& context);
+
+    // On an amplitude envelope sampled at envelopeRate (ModulationMeter keeps one at ~200 Hz).
+    // Depth is the AM index: sqrt(2) * standard deviation / mean, 1 for a sine LFO swinging to silence.
+    // Rate is the first autocorrelation peak between minRateHz and maxRateHz, 0 if nothing periodic is found.
+    float computeModulationDepth(const float* envelope, int numValues);
+    float computeModulationRate(const float* envelope, int numValues, double envelopeRate,
+                                float minRateHz = 0.5f, float maxRateHz = 20.0f);
 
+    // FFT size and window are runtime settings now, see FftPlan
     enum
     {
-        fftOrder = 12,              // this designates the size of the fft 2 ^ fft_Order
-        fftSize = 1 << fftOrder,    // calculating the fftSize
         scopeSize = 2048             // number of points in the visual representation
     };
 
@@ -0,0 +1,84 @@
+#include "ModulationMeter.h"
+#include "Metrics.h"
+
+void ModulationMeter::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    decimation = juce::jmax(1, juce::roundToInt(sampleRate / targetEnvelopeRate));
+    envelopeRate = sampleRate / decimation;
+    updateInterval = juce::jmax(1, juce::roundToInt(envelopeRate * updateSeconds));
+
+    historyLength = (int)std::ceil(envelopeRate * historySeconds);
+    history.allocate((size_t)historyLength * 2, true);
+
+    reset();
+}
+
+void ModulationMeter::reset() noexcept
+{
+    blockSum = 0.0;
+    blockCount = 0;
+    writePosition = numValid = sinceUpdate = 0;
+    rate = depth = 0.0f;
+}
+
+void ModulationMeter::process(const juce::AudioBuffer<float>& buffer, int numSamples) noexcept
+{
+    auto numChannels = buffer.getNumChannels();
+    if (numChannels == 0)
+        return;
+
+    // Block RMS of the channel mean: a boxcar before decimating, plenty for envelopes under 20 Hz
+    auto channelGain = 1.0f / (float)numChannels;
+    auto* const* channels = buffer.getArrayOfReadPointers();
+
+    for (int n = 0; n < numSamples;)
+    {
+        auto count = juce::jmin(numSamples - n, decimation - blockCount);
+
+        for (int i = n; i < n + count; ++i)
+        {
+            float mono = 0.0f;
+            for (int ch = 0; ch < numChannels; ++ch)
+                mono += channels[ch][i];
+            mono *= channelGain;
+            blockSum += (double)mono * mono;
+        }
+
+        n += count;
+        blockCount += count;
+
+        if (blockCount == decimation)
+        {
+            pushEnvelope((float)std::sqrt(blockSum / decimation));
+            blockSum = 0.0;
+            blockCount = 0;
+        }
+    }
+}
+
+void ModulationMeter::pushEnvelope(float value) noexcept
+{
+    history[writePosition] = history[writePosition + historyLength] = value;
+    writePosition = (writePosition + 1) % historyLength;
+    numValid = juce::jmin(numValid + 1, historyLength);
+
+    if (++sinceUpdate >= updateInterval)
+    {
+        sinceUpdate = 0;
+        estimate();
+    }
+}
+
+const float* ModulationMeter::getEnvelope(int numValues) const noexcept
+{
+    numValues = juce::jlimit(0, numValid, numValues);
+    return history + writePosition + historyLength - numValues;
+}
+
+void ModulationMeter::estimate() noexcept
+{
+    auto* envelope = getEnvelope(numValid);
+    rate = Metrics::computeModulationRate(envelope, numValid, envelopeRate);
+    depth = Metrics::computeModulationDepth(envelope, numValid);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// ===============================================================================================================
+// Streaming amplitude envelope of the mixed-down signal, decimated to about 200 Hz, with the last few seconds
+// kept for estimating modulation rate and depth (tremolo, chorus beating, LFO-driven filters and the like).
+//
+// Every sample goes into a block RMS once; everything after that runs at the envelope rate, ~200x less work
+// than analysing full-rate audio. The history is a mirrored ring so the estimators always see one contiguous
+// block, oldest first.
+class ModulationMeter
+{
+public:
+    static constexpr double targetEnvelopeRate = 200.0;   // Hz
+    static constexpr double historySeconds = 4.0;         // two periods of the slowest rate reported, 0.5 Hz
+    static constexpr double updateSeconds = 0.1;
+
+    ModulationMeter() = default;
+
+    // Allocates, call before processing
+    void prepare(double newSampleRate);
+    void reset() noexcept;
+
+    // Analysis thread: feed every sample exactly once
+    void process(const juce::AudioBuffer<float>& buffer, int numSamples) noexcept;
+
+    float getRate() const noexcept { return rate; }      // Hz, 0 when nothing periodic
+    float getDepth() const noexcept { return depth; }    // AM index, see Metrics::computeModulationDepth
+    double getEnvelopeRate() const noexcept { return envelopeRate; }
+
+    // The newest numValues envelope values, oldest first
+    const float* getEnvelope(int numValues) const noexcept;
+    int getNumEnvelopeValues() const noexcept { return numValid; }
+
+private:
+    void pushEnvelope(float value) noexcept;
+    void estimate() noexcept;
+
+    double sampleRate = 44100.0;
+    double envelopeRate = targetEnvelopeRate;
+    int decimation = 1;
+    int updateInterval = 1;
+
+    double blockSum = 0.0;          // sum of squares of the block in progress
+    int blockCount = 0;
+
+    juce::HeapBlock<float> history; // 2 * historyLength
+    int historyLength = 0;
+    int writePosition = 0;
+    int numValid = 0;
+    int sinceUpdate = 0;
+
+    float rate = 0.0f, depth = 0.0f;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ModulationMeter)
+};
@@ -0,0 +1,68 @@
+#include "PitchMeter.h"
+
+void PitchMeter::prepare(const FftPlan& plan)
+{
+    sampleRate = plan.getSampleRate();
+    fftSize = plan.getSize();
+    numLags = fftSize / 2;
+    fft = &plan.getFft();
+    auto* window = plan.getWindow();
+
+    fftData.allocate((size_t)fftSize * 2, true);
+    inverseWindowCorrelation.allocate((size_t)numLags, true);
+    autocorrelation.allocate((size_t)numLags, true);
+
+    // Window autocorrelation through the same circular path the signal takes
+    for (int n = 0; n < fftSize; ++n)
+        fftData[n] = window[n];
+    std::fill(fftData.get() + fftSize, fftData.get() + fftSize * 2, 0.0f);
+    fft->performRealOnlyForwardTransform(fftData.get(), true);
+
+    for (int k = 0; k <= fftSize / 2; ++k)
+    {
+        fftData[2 * k] = fftData[2 * k] * fftData[2 * k] + fftData[2 * k + 1] * fftData[2 * k + 1];
+        fftData[2 * k + 1] = 0.0f;
+    }
+    fft->performRealOnlyInverseTransform(fftData.get());
+
+    // Lags where the window barely overlaps itself would only amplify noise, leave them at 0
+    for (int lag = 0; lag < numLags; ++lag)
+    {
+        auto w = fftData[lag] / fftData[0];
+        inverseWindowCorrelation[lag] = w > 0.1f ? 1.0f / w : 0.0f;
+    }
+
+    estimate = {};
+    harmonicToNoise = -60.0f;
+}
+
+void PitchMeter::autocorrelate(const float* power) noexcept
+{
+    auto* data = fftData.get();
+    for (int k = 0; k <= fftSize / 2; ++k)
+    {
+        data[2 * k] = power[k];
+        data[2 * k + 1] = 0.0f;
+    }
+
+    fft->performRealOnlyInverseTransform(data);
+
+    auto scale = data[0] > 0.0f ? 1.0f / data[0] : 0.0f;
+    for (int lag = 0; lag < numLags; ++lag)
+        autocorrelation[lag] = data[lag] * scale * inverseWindowCorrelation[lag];
+}
+
+void PitchMeter::process(const SpectrumFrame& spectrum) noexcept
+{
+    if (spectrum.getTotalPower() <= 0.0)
+    {
+        estimate = {};
+        harmonicToNoise = -60.0f;
+        return;
+    }
+
+    autocorrelate(spectrum.getPower());
+
+    estimate = Metrics::computePitch(autocorrelation.get(), numLags, sampleRate);
+    harmonicToNoise = estimate.f0Hz > 0.0f ? Metrics::computeHarmonicToNoiseRatio(estimate.periodicity) : -60.0f;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "SpectrumFrame.h"
+#include "Metrics.h"
+
+// ===============================================================================================================
+// Fundamental, periodicity and harmonic-to-noise ratio of each analysis frame, from the power spectrum the
+// spectral metrics already use.
+//
+// The autocorrelation is one inverse real FFT of that power spectrum (Wiener-Khinchin), O(N log N) instead
+// of O(N^2) per frame. It is divided by the autocorrelation of the analysis window, computed the same way
+// once in prepare(), which undoes the window's taper (Boersma 1993) and, because both are circular, most of
+// the wrap-around too. Metrics::computePitch then runs YIN on the result.
+class PitchMeter
+{
+public:
+    // Below this confidence the frame counts as unpitched
+    static constexpr float voicingThreshold = 0.5f;
+
+    PitchMeter() = default;
+
+    // Allocates. plan is the STFT's and must outlive this. Analysis thread or while it is stopped.
+    void prepare(const FftPlan& plan);
+
+    void process(const SpectrumFrame& spectrum) noexcept;
+
+    float getFundamental() const noexcept { return estimate.confidence >= voicingThreshold ? estimate.f0Hz : 0.0f; } // Hz, 0 if unpitched
+    float getConfidence() const noexcept { return estimate.confidence; }
+    float getHarmonicToNoise() const noexcept { return harmonicToNoise; } // dB
+
+private:
+    // Inverse real FFT of a power spectrum into fftData, normalised to lag 0
+    void autocorrelate(const float* power) noexcept;
+
+    double sampleRate = 44100.0;
+    int fftSize = 0;
+    int numLags = 0;                        // usable lags, up to fftSize / 2
+
+    const juce::dsp::FFT* fft = nullptr;   // the plan's
+    juce::HeapBlock<float> fftData;         // 2 * fftSize
+    juce::HeapBlock<float> inverseWindowCorrelation;
+    juce::HeapBlock<float> autocorrelation;
+
+    Metrics::PitchEstimate estimate;
+    float harmonicToNoise = -60.0f;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(PitchMeter)
+};
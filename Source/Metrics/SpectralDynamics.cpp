@@ -0,0 +1,144 @@
+#include "SpectralDynamics.h"
+
+void SpectralDynamics::prepare(double maxFrameRate)
+{
+    capacityFrames = juce::jmax(1, (int)std::ceil(maxFrameRate * maxHistorySeconds));
+
+    rows.allocate((size_t)capacityFrames * 2 * maxBands, true);
+    dequeStorage.allocate((size_t)(capacityFrames + 1) * 2 * maxBands, true);
+
+    numBands = 0;
+    historyFrames = 0;
+    frameRate = 0.0;
+    configure(maxBands, maxFrameRate, defaultHistorySeconds);
+}
+
+void SpectralDynamics::configure(int newNumBands, double newFrameRate, double newHistorySeconds) noexcept
+{
+    newNumBands = juce::jlimit(1, (int)maxBands, newNumBands);
+    auto newHistoryFrames = juce::jlimit(1, capacityFrames, (int)std::ceil(newFrameRate * newHistorySeconds));
+
+    if (newNumBands == numBands && newHistoryFrames == historyFrames && newFrameRate == frameRate)
+        return;
+
+    numBands = newNumBands;
+    historyFrames = newHistoryFrames;
+    frameRate = newFrameRate;
+
+    // One spare entry per deque, so a full window plus the entry being pushed always fits
+    auto dequeStride = (size_t)capacityFrames + 1;
+    for (int b = 0; b < maxBands; ++b)
+    {
+        minima[(size_t)b] = { dequeStorage + (size_t)(2 * b) * dequeStride, historyFrames + 1 };
+        maxima[(size_t)b] = { dequeStorage + (size_t)(2 * b + 1) * dequeStride, historyFrames + 1 };
+    }
+
+    reset();
+}
+
+void SpectralDynamics::reset() noexcept
+{
+    writeRow = numFrames = 0;
+    sequence = 0;
+
+    for (int b = 0; b < maxBands; ++b)
+    {
+        minima[(size_t)b].clear();
+        maxima[(size_t)b].clear();
+    }
+
+    sums.fill(0.0);
+    sumsOfSquares.fill(0.0);
+}
+
+template <typename Compare>
+void SpectralDynamics::pushMonotonic(Deque& deque, Entry entry, int32_t oldestSequence, Compare keepBefore) noexcept
+{
+    // Frames that left the history go first, otherwise a monotonic run keeps them all and overflows the ring
+    while (deque.size > 0 && deque.front().sequence < oldestSequence)
+        deque.popFront();
+
+    // Anything the new value beats can never be the extreme again
+    while (deque.size > 0 && !keepBefore(deque.back().value, entry.value))
+        deque.popBack();
+
+    deque.pushBack(entry);
+}
+
+void SpectralDynamics::push(const float* levels) noexcept
+{
+    auto stride = (size_t)numBands;
+    auto* row = rows + (size_t)writeRow * stride;
+    auto* mirror = rows + (size_t)(writeRow + historyFrames) * stride;
+
+    // The row about to be overwritten leaves the running sums
+    auto evicting = numFrames == historyFrames;
+    for (int b = 0; b < numBands; ++b)
+    {
+        if (evicting)
+        {
+            sums[(size_t)b] -= row[b];
+            sumsOfSquares[(size_t)b] -= (double)row[b] * row[b];
+        }
+
+        auto level = levels[b];
+        row[b] = mirror[b] = level;
+        sums[(size_t)b] += level;
+        sumsOfSquares[(size_t)b] += (double)level * level;
+    }
+
+    auto oldestSequence = sequence - historyFrames + 1;
+    for (int b = 0; b < numBands; ++b)
+    {
+        Entry entry{ sequence, levels[b] };
+        pushMonotonic(minima[(size_t)b], entry, oldestSequence, [](float kept, float added) { return kept < added; });
+        pushMonotonic(maxima[(size_t)b], entry, oldestSequence, [](float kept, float added) { return kept > added; });
+    }
+
+    ++sequence;
+    writeRow = (writeRow + 1) % historyFrames;
+    numFrames = juce::jmin(numFrames + 1, historyFrames);
+}
+
+SpectralDynamics::View SpectralDynamics::getLatest(int numFramesWanted) const noexcept
+{
+    View view;
+    view.numBands = numBands;
+    view.numFrames = juce::jlimit(0, numFrames, numFramesWanted);
+
+    // The newest row is at writeRow - 1, so the block ends just before writeRow + historyFrames
+    auto firstRow = writeRow + historyFrames - view.numFrames;
+    view.data = rows + (size_t)firstRow * (size_t)numBands;
+    return view;
+}
+
+SpectralDynamics::View SpectralDynamics::getLatestSeconds(double seconds) const noexcept
+{
+    return getLatest((int)std::ceil(seconds * frameRate));
+}
+
+float SpectralDynamics::getMin(int band) const noexcept
+{
+    auto& deque = minima[(size_t)band];
+    return deque.size > 0 ? deque.front().value : 0.0f;
+}
+
+float SpectralDynamics::getMax(int band) const noexcept
+{
+    auto& deque = maxima[(size_t)band];
+    return deque.size > 0 ? deque.front().value : 0.0f;
+}
+
+float SpectralDynamics::getMean(int band) const noexcept
+{
+    return numFrames > 0 ? (float)(sums[(size_t)band] / numFrames) : 0.0f;
+}
+
+float SpectralDynamics::getVariance(int band) const noexcept
+{
+    if (numFrames == 0)
+        return 0.0f;
+
+    auto mean = sums[(size_t)band] / numFrames;
+    return (float)juce::jmax(0.0, sumsOfSquares[(size_t)band] / numFrames - mean * mean);
+}
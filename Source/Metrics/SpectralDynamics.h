@@ -0,0 +1,100 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Filterbank.h"
+
+// ===============================================================================================================
+// Band level over time: a fixed-capacity ring of per-band RMS frames (dB), e.g. to watch a multiband
+// compressor move energy around without keeping any audio.
+//
+// Frames are stored mirrored (row i at i and i + historyFrames), so the newest N frames are always one
+// contiguous numFrames x numBands block and a view never copies. Per-band statistics over the whole history
+// are kept incrementally: running sums for mean and variance, and monotonic deques for min and max, so
+// push() is O(numBands) amortised whatever the history length.
+//
+// Everything is allocated by prepare() for the largest band set and history, configure() only re-slices it.
+class SpectralDynamics
+{
+public:
+    enum { maxBands = Filterbank::numMelBands };
+
+    static constexpr double maxHistorySeconds = 30.0;
+    static constexpr double defaultHistorySeconds = 10.0;
+
+    // Rows of numBands levels, oldest first, valid until the next push()
+    struct View
+    {
+        const float* data = nullptr;
+        int numFrames = 0;
+        int numBands = 0;
+
+        const float* getFrame(int index) const noexcept { return data + (size_t)index * (size_t)numBands; }
+        float getLevel(int frameIndex, int band) const noexcept { return getFrame(frameIndex)[band]; }
+    };
+
+    SpectralDynamics() = default;
+
+    // Allocates, call while the analysis thread is stopped. maxFrameRate is the highest frames per second
+    // configure() will be asked for.
+    void prepare(double maxFrameRate);
+
+    // Never allocates. Clears the history if anything changed.
+    void configure(int newNumBands, double newFrameRate, double newHistorySeconds) noexcept;
+    void reset() noexcept;
+
+    // numBands levels in dB
+    void push(const float* levels) noexcept;
+
+    int getNumBands() const noexcept { return numBands; }
+    int getNumFrames() const noexcept { return numFrames; }
+    double getFrameRate() const noexcept { return frameRate; }
+
+    View getLatest(int numFramesWanted) const noexcept;
+    View getLatestSeconds(double seconds) const noexcept;
+
+    // Over the whole history
+    float getMin(int band) const noexcept;
+    float getMax(int band) const noexcept;
+    float getMean(int band) const noexcept;
+    float getVariance(int band) const noexcept;
+
+private:
+    struct Entry
+    {
+        int32_t sequence;
+        float value;
+    };
+
+    // Fixed-capacity ring of entries, the monotonic deque of one band
+    struct Deque
+    {
+        Entry* entries = nullptr;
+        int capacity = 0, head = 0, size = 0;
+
+        Entry& front() const noexcept { return entries[head]; }
+        Entry& back() const noexcept { return entries[(head + size - 1) % capacity]; }
+        void popFront() noexcept { head = (head + 1) % capacity; --size; }
+        void popBack() noexcept { --size; }
+        void pushBack(Entry e) noexcept { entries[(head + size++) % capacity] = e; }
+        void clear() noexcept { head = size = 0; }
+    };
+
+    template <typename Compare>
+    static void pushMonotonic(Deque& deque, Entry entry, int32_t oldestSequence, Compare keepBefore) noexcept;
+
+    int capacityFrames = 0;
+    int numBands = 0;
+    int historyFrames = 0;
+    double frameRate = 0.0;
+
+    juce::HeapBlock<float> rows;            // 2 * capacityFrames * maxBands
+    int writeRow = 0;                       // next row to write, in [0, historyFrames)
+    int numFrames = 0;                      // valid rows, up to historyFrames
+    int32_t sequence = 0;
+
+    juce::HeapBlock<Entry> dequeStorage;    // 2 * maxBands * (capacityFrames + 1)
+    std::array<Deque, maxBands> minima, maxima;
+    std::array<double, maxBands> sums{}, sumsOfSquares{};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectralDynamics)
+};
@@ -0,0 +1,61 @@
+#include "SpectrumFrame.h"
+
+void SpectrumFrame::prepare(const FftPlan& plan)
+{
+    fftSize = plan.getSize();
+    numBins = plan.getNumBins();
+    sampleRate = plan.getSampleRate();
+    frequencies = plan.getFrequencies();
+
+    magnitudePrefix.allocate((size_t)numBins + 1, true);
+    powerPrefix.allocate((size_t)numBins + 1, true);
+
+    magnitude = power = nullptr;
+    weightedFrequencySum = 0.0;
+    peakBin = 0;
+}
+
+void SpectrumFrame::compute(const float* newMagnitude, const float* newPower) noexcept
+{
+    magnitude = newMagnitude;
+    power = newPower;
+
+    double magnitudeSum = 0.0, powerSum = 0.0, weighted = 0.0;
+    float peak = -1.0f;
+    int peakIndex = juce::jmin(1, numBins - 1);
+
+    magnitudePrefix[0] = powerPrefix[0] = 0.0;
+    for (int k = 0; k < numBins; ++k)
+    {
+        auto m = magnitude[k];
+        magnitudeSum += m;
+        powerSum += power[k];
+        weighted += (double)frequencies[k] * m;
+        magnitudePrefix[k + 1] = magnitudeSum;
+        powerPrefix[k + 1] = powerSum;
+
+        if (k > 0 && m > peak)
+        {
+            peak = m;
+            peakIndex = k;
+        }
+    }
+
+    weightedFrequencySum = weighted;
+    peakBin = peakIndex;
+}
+
+int SpectrumFrame::binForFrequency(double frequencyHz) const noexcept
+{
+    return juce::jlimit(0, numBins, (int)std::ceil(frequencyHz / getBinWidth()));
+}
+
+int SpectrumFrame::findCumulativeMagnitudeBin(double fraction) const noexcept
+{
+    auto threshold = getTotalMagnitude() * fraction;
+
+    // prefix[k + 1] is the cumulative magnitude up to and including bin k
+    auto* first = magnitudePrefix.get() + 1;
+    auto* found = std::lower_bound(first, first + numBins, threshold);
+    return juce::jmin(numBins - 1, (int)(found - first));
+}
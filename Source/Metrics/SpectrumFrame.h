@@ -0,0 +1,63 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "FftPlan.h"
+
+// ===============================================================================================================
+// One analysed spectrum, shared by every spectral metric of a frame.
+// Magnitude and power come from the FFT stage (computed once, in one flat pass), bin frequencies from the
+// FftPlan. compute() adds what the metrics kept recomputing in their own loops: prefix sums of magnitude and power, the
+// magnitude-weighted frequency sum and the strongest non-DC bin. Band sums are then O(1) and the rolloff
+// point a binary search.
+class SpectrumFrame
+{
+public:
+    SpectrumFrame() = default;
+
+    // Allocates. plan must outlive this. Analysis thread or while it is stopped.
+    void prepare(const FftPlan& plan);
+
+    // magnitude and power hold getNumBins() values and must outlive this frame's use
+    void compute(const float* newMagnitude, const float* newPower) noexcept;
+
+    int getFftSize() const noexcept { return fftSize; }
+    int getNumBins() const noexcept { return numBins; }          // fftSize / 2 + 1, DC to Nyquist
+    double getSampleRate() const noexcept { return sampleRate; }
+    double getBinWidth() const noexcept { return sampleRate / fftSize; }
+
+    const float* getMagnitude() const noexcept { return magnitude; }
+    const float* getPower() const noexcept { return power; }
+    const float* getFrequencies() const noexcept { return frequencies; }
+
+    // First bin at or above frequencyHz, getNumBins() past Nyquist. Use as a half-open band edge.
+    int binForFrequency(double frequencyHz) const noexcept;
+
+    // Sums over bins [startBin, endBin)
+    double getMagnitudeSum(int startBin, int endBin) const noexcept { return magnitudePrefix[endBin] - magnitudePrefix[startBin]; }
+    double getPowerSum(int startBin, int endBin) const noexcept { return powerPrefix[endBin] - powerPrefix[startBin]; }
+    double getTotalMagnitude() const noexcept { return magnitudePrefix[numBins]; }
+    double getTotalPower() const noexcept { return powerPrefix[numBins]; }
+
+    // First bin at which the cumulative magnitude reaches `fraction` of the total
+    int findCumulativeMagnitudeBin(double fraction) const noexcept;
+
+    double getMagnitudeWeightedFrequency() const noexcept { return weightedFrequencySum; }  // sum of f * |X|
+    int getPeakBin() const noexcept { return peakBin; }        // strongest bin above DC
+
+private:
+    int fftSize = 0;
+    int numBins = 0;
+    double sampleRate = 44100.0;
+
+    const float* magnitude = nullptr;
+    const float* power = nullptr;
+
+    const float* frequencies = nullptr;    // the plan's
+    juce::HeapBlock<double> magnitudePrefix;   // numBins + 1, prefix[k] = sum of bins below k
+    juce::HeapBlock<double> powerPrefix;
+
+    double weightedFrequencySum = 0.0;
+    int peakBin = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SpectrumFrame)
+};
@@ -0,0 +1,237 @@
+#include "SweepMeter.h"
+#include "FastMath.h"
+#include "../Engine/StimulusGenerator.h"
+
+namespace
+{
+    // Band limit of the inverse filter: raised cosine over the octave above the start of the sweep and the
+    // third octave below its end, so the deconvolved response doesn't ring from brick-wall edges
+    double getInverseTaper(double hz, double sampleRate) noexcept
+    {
+        auto startHz = StimulusGenerator::sweepStartHz;
+        auto endHz = StimulusGenerator::getSweepEndHz(sampleRate);
+        if (hz <= startHz || hz >= endHz)
+            return 0.0;
+
+        auto up = juce::jmin(1.0, std::log2(hz / startHz));
+        auto down = juce::jmin(1.0, 3.0 * std::log2(endHz / hz));
+        return 0.25 * (1.0 - std::cos(juce::MathConstants<double>::pi * up))
+                    * (1.0 - std::cos(juce::MathConstants<double>::pi * down));
+    }
+}
+
+void SweepMeter::prepare(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    period = StimulusGenerator::getSweepLength(sampleRate);
+    fft = std::make_unique<juce::dsp::FFT>(juce::roundToInt(std::log2((double)period)));
+
+    capture.allocate((size_t)period, true);
+    spectrum.allocate((size_t)period, true);
+    inverseFilter.allocate((size_t)period, true);
+    response.allocate((size_t)period, true);
+
+    juce::HeapBlock<float> sweep((size_t)period);
+    StimulusGenerator::fillSweep(sweep.get(), sampleRate);
+    for (int n = 0; n < period; ++n)
+        capture[n] = { sweep[n], 0.0f };
+    fft->perform(capture.get(), spectrum.get(), false);
+
+    // The sweep is periodic, so its own DFT inverts it exactly: 1 / X, regularised against the empty bins
+    // outside the sweep and tapered at its ends. That's what Farina's time-reversed, +6 dB/octave sweep
+    // approximates, minus its ripple, and it keeps a linear chain's harmonic windows ~100 dB down.
+    double meanPower = 0.0;
+    for (int k = 0; k < period; ++k)
+        meanPower += std::norm(spectrum[k]);
+    auto regularisation = (float)(1.0e-4 * meanPower / period);
+
+    double peakSum = 0.0;
+    for (int k = 0; k < period; ++k)
+    {
+        auto hz = (k <= period / 2 ? k : period - k) * sampleRate / period;
+        auto taper = (float)getInverseTaper(hz, sampleRate);
+        inverseFilter[k] = taper * std::conj(spectrum[k]) / (std::norm(spectrum[k]) + regularisation);
+        peakSum += (spectrum[k] * inverseFilter[k]).real();
+    }
+
+    // What the sweep itself deconvolves to at lag 0, straight from the inverse DFT sum, so the scaling of the
+    // inverse FFT cancels in analyse()
+    unitPeak = (float)(peakSum / period);
+
+    auto rate = (double)period / std::log(StimulusGenerator::getSweepEndHz(sampleRate) / StimulusGenerator::sweepStartHz);
+    harmonicDelays.fill(0);
+    for (int h = 2; h < (int)harmonicDelays.size(); ++h)
+        harmonicDelays[(size_t)h] = juce::roundToInt(rate * std::log((double)h));
+
+    // Band response of the linear part, from as much of it as fits before the 2nd harmonic's window
+    auto responseOrder = juce::roundToInt(std::log2((double)juce::nextPowerOfTwo(juce::jmax(16, harmonicDelays[2] / 2))));
+    responseFftSize = 1 << responseOrder;
+    responseFft = std::make_unique<juce::dsp::FFT>(responseOrder);
+    responseData.allocate((size_t)responseFftSize * 2, true);
+    responsePower.allocate((size_t)responseFftSize / 2 + 1, true);
+    bands.prepare(Filterbank::Scale::thirdOctave, responseFftSize, sampleRate);
+
+    auto numBands = (size_t)bands.getNumBands();
+    bandPower.assign(numBands, 0.0f);
+    bandWeights.assign(numBands, 0.0f);
+    bandGains.assign(numBands, 0.0f);
+
+    // What a flat 0 dB chain sums to in each band through the taper, so the band edges read true as well.
+    // Bands the sweep covers less than half of are left out.
+    std::fill(responsePower.get(), responsePower.get() + responseFftSize / 2 + 1, 1.0f);
+    bands.apply(responsePower.get(), bandPower.data());
+
+    for (int k = 0; k <= responseFftSize / 2; ++k)
+    {
+        auto taper = getInverseTaper(k * sampleRate / responseFftSize, sampleRate);
+        responsePower[k] = (float)(taper * taper);
+    }
+    bands.apply(responsePower.get(), bandWeights.data());
+
+    for (size_t b = 0; b < numBands; ++b)
+        if (bandWeights[b] < 0.5f * bandPower[b])
+            bandWeights[b] = 0.0f;
+
+    reset();
+}
+
+void SweepMeter::reset() noexcept
+{
+    std::fill(capture.get(), capture.get() + period, std::complex<float>());
+    writePosition = sinceCapture = numPeriods = 0;
+
+    latency = 0;
+    harmonicLevels.fill(-200.0f);
+    thd = 0.0f;
+    std::fill(bandGains.begin(), bandGains.end(), 0.0f);
+    numCaptures = 0;
+}
+
+void SweepMeter::process(const juce::AudioBuffer<float>& output, const juce::AudioBuffer<float>& reference, int numSamples) noexcept
+{
+    auto numOutputChannels = output.getNumChannels();
+    auto numReferenceChannels = reference.getNumChannels();
+    if (numOutputChannels == 0 || numReferenceChannels == 0)
+        return;
+
+    auto outputGain = 1.0f / (float)numOutputChannels;
+    auto referenceGain = 1.0f / (float)numReferenceChannels;
+
+    for (int n = 0; n < numSamples; ++n)
+    {
+        // Channel means, output real and reference imaginary
+        auto out = 0.0f, ref = 0.0f;
+        for (int ch = 0; ch < numOutputChannels; ++ch)
+            out += output.getSample(ch, n);
+        for (int ch = 0; ch < numReferenceChannels; ++ch)
+            ref += reference.getSample(ch, n);
+
+        capture[writePosition] = { out * outputGain, ref * referenceGain };
+        writePosition = (writePosition + 1) & (period - 1);
+
+        // The first period only primes the plugins' tails, the response is periodic from the second on
+        if (++sinceCapture == period)
+        {
+            sinceCapture = 0;
+            if (++numPeriods > 1)
+                analyse();
+        }
+    }
+}
+
+void SweepMeter::analyse() noexcept
+{
+    // The ring is rotated by writePosition, which circular deconvolution doesn't care about: the reference
+    // is rotated the same way and realigns everything below. Every sample gets overwritten before the next
+    // analysis, so the ring doubles as the output of the inverse FFT.
+    fft->perform(capture.get(), spectrum.get(), false);
+    for (int k = 0; k < period; ++k)
+        spectrum[k] *= inverseFilter[k];
+    fft->perform(spectrum.get(), capture.get(), true);
+
+    int referenceLag = 0;
+    auto referencePeak = 0.0f;
+    for (int n = 0; n < period; ++n)
+    {
+        if (std::abs(capture[n].imag()) > std::abs(referencePeak))
+        {
+            referencePeak = capture[n].imag();
+            referenceLag = n;
+        }
+    }
+
+    if (referencePeak == 0.0f)
+        return;
+
+    // The reference's peak over the unit sweep's is the stimulus level (times the inverse FFT's scaling)
+    auto mask = period - 1;
+    auto scale = unitPeak / referencePeak;
+    for (int n = 0; n < period; ++n)
+        response[n] = capture[(n + referenceLag) & mask].real() * scale;
+
+    // Linear part: half the gap to the 2nd harmonic either side of lag 0
+    auto linearReach = harmonicDelays[2] / 2;
+    auto peak = 0.0f;
+    for (int lag = -linearReach; lag < linearReach; ++lag)
+    {
+        auto value = std::abs(response[lag & mask]);
+        if (value > peak)
+        {
+            peak = value;
+            latency = lag;
+        }
+    }
+
+    auto linearEnergy = getEnergy(-linearReach, linearReach);
+    if (linearEnergy <= 0.0)
+        return;
+
+    // Harmonic h: from halfway towards h + 1 to halfway towards h - 1
+    double harmonicEnergy = 0.0;
+    for (int h = 2; h <= maxHarmonic; ++h)
+    {
+        auto delay = harmonicDelays[(size_t)h];
+        auto first = -delay - (harmonicDelays[(size_t)h + 1] - delay) / 2;
+        auto end = -delay + (delay - harmonicDelays[(size_t)h - 1]) / 2;
+
+        auto energy = getEnergy(first, end);
+        harmonicEnergy += energy;
+        harmonicLevels[(size_t)h] = FastMath::powerToDecibels((float)juce::jmax(1.0e-20, energy / linearEnergy));
+    }
+
+    thd = (float)std::sqrt(harmonicEnergy / linearEnergy);
+    computeBandGains();
+    ++numCaptures;
+}
+
+double SweepMeter::getEnergy(int firstLag, int endLag) const noexcept
+{
+    double sum = 0.0;
+    for (int lag = firstLag; lag < endLag; ++lag)
+    {
+        auto value = response[lag & (period - 1)];
+        sum += (double)value * value;
+    }
+    return sum;
+}
+
+void SweepMeter::computeBandGains() noexcept
+{
+    // A window of the linear response starting a little before lag 0, for pre-ringing
+    auto preRoll = responseFftSize / 16;
+    auto* data = responseData.get();
+    for (int n = 0; n < responseFftSize; ++n)
+        data[n] = response[(n - preRoll) & (period - 1)];
+
+    responseFft->performRealOnlyForwardTransform(data, true);
+
+    auto numBins = responseFftSize / 2 + 1;
+    for (int k = 0; k < numBins; ++k)
+        responsePower[k] = data[2 * k] * data[2 * k] + data[2 * k + 1] * data[2 * k + 1];
+
+    bands.apply(responsePower.get(), bandPower.data());
+    for (size_t b = 0; b < bandGains.size(); ++b)
+        bandGains[b] = bandWeights[b] > 0.0f && bandPower[b] > 0.0f
+                     ? FastMath::powerToDecibels(bandPower[b] / bandWeights[b])
+                     : 0.0f;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Filterbank.h"
+
+// ===============================================================================================================
+// Impulse response, harmonic distortion and latency of the hosted plugins from the exponential sweep (Farina).
+//
+// The sweep repeats back to back with a power-of-two period, so the steady-state output is periodic too and
+// one period, recorded in any phase, can be deconvolved circularly: one forward FFT, a multiply by the
+// precomputed inverse filter and one inverse FFT. The output and the reference stimulus are packed into the
+// real and imaginary parts of that single complex FFT, like ChannelSpectra does. The reference deconvolves to
+// a clean impulse, whose position and height then align and scale the output's response, so capture phase and
+// stimulus level drop out.
+//
+// The inverse filter is built from the periodic sweep's own DFT X rather than Farina's time-reversed,
+// +6 dB/octave approximation: conj(X) / (|X|^2 + e) per bin, e a small regularisation against the empty bins
+// outside the sweep, with a raised-cosine taper at both ends of the swept band. See prepare().
+//
+// The linear impulse response sits at lag 0. The h-th harmonic's response arrives L ln h samples earlier
+// (L = period / ln(f2 / f1)), so each one is cut out of the same result by its own window: that is what
+// makes one sweep enough for frequency response, distortion and latency together.
+class SweepMeter
+{
+public:
+    enum { maxHarmonic = 5 };       // 2nd .. 5th harmonic
+
+    SweepMeter() = default;
+
+    // Allocates and builds the inverse filter, call while the analysis thread is stopped
+    void prepare(double newSampleRate);
+    void reset() noexcept;
+
+    // Analysis thread: feed every sample exactly once while the sweep is playing. reference holds the stimulus
+    // that went into the plugins, sample aligned with output.
+    void process(const juce::AudioBuffer<float>& output, const juce::AudioBuffer<float>& reference, int numSamples) noexcept;
+
+    bool isRunning() const noexcept { return numPeriods > 0 || sinceCapture > 0; }
+    bool hasReading() const noexcept { return numCaptures > 0; }
+    int getNumCaptures() const noexcept { return numCaptures; }
+
+    // One period of the deconvolved response, lag 0 at index 0 and negative lags wrapped to the end. The linear
+    // impulse response starts at index 0, harmonic h's at getPeriod() - getHarmonicDelay(h).
+    const float* getResponse() const noexcept { return response.get(); }
+    int getPeriod() const noexcept { return period; }
+    int getHarmonicDelay(int h) const noexcept { return harmonicDelays[(size_t)h]; }
+
+    // Lag of the linear response's peak in samples, on top of whatever latency the reference was delayed by
+    int getLatency() const noexcept { return latency; }
+
+    // Harmonic h (2 .. maxHarmonic) energy relative to the linear response, in dB, and their sum as a ratio.
+    // Broadband: every harmonic is integrated over the whole sweep.
+    float getHarmonicLevel(int h) const noexcept { return harmonicLevels[(size_t)h]; }
+    float getTHD() const noexcept { return thd; }
+
+    // Linear response per third octave, dB. Bands outside the sweep read 0.
+    int getNumBands() const noexcept { return bands.getNumBands(); }
+    float getBandGain(int band) const noexcept { return bandGains[(size_t)band]; }
+
+private:
+    void analyse() noexcept;
+    double getEnergy(int firstLag, int endLag) const noexcept;
+    void computeBandGains() noexcept;
+
+    double sampleRate = 44100.0;
+    int period = 0;
+
+    std::unique_ptr<juce::dsp::FFT> fft;
+    juce::HeapBlock<std::complex<float>> capture;       // output + i reference, circular, one period
+    juce::HeapBlock<std::complex<float>> spectrum;
+    juce::HeapBlock<std::complex<float>> inverseFilter; // spectrum of the inverse sweep
+    float unitPeak = 1.0f;                              // the sweep itself, deconvolved, at lag 0
+    juce::HeapBlock<float> response;
+    int writePosition = 0;
+    int sinceCapture = 0;
+    int numPeriods = 0;
+
+    // Harmonic h's response starts harmonicDelays[h] before the linear one, [1] = 0
+    std::array<int, maxHarmonic + 2> harmonicDelays{};
+
+    Filterbank bands;                       // third octaves at responseFftSize
+    int responseFftSize = 0;
+    std::unique_ptr<juce::dsp::FFT> responseFft;
+    juce::HeapBlock<float> responseData, responsePower;
+    std::vector<float> bandPower, bandWeights, bandGains;
+
+    int latency = 0;
+    std::array<float, maxHarmonic + 1> harmonicLevels{};
+    float thd = 0.0f;
+    int numCaptures = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SweepMeter)
+};
@@ -0,0 +1,165 @@
+#include "TransferFunctionMeter.h"
+#include "FastMath.h"
+
+namespace
+{
+    // Band sums kept per band, in this order, in bandScratch
+    enum BandSum
+    {
+        sumCrossMagnitude,
+        sumInputPower,
+        sumCrossPower,
+        sumAutoProduct,
+        sumCrossReal,
+        sumCrossImag,
+        sumDelayReal,
+        sumDelayImag,
+        numBandSums
+    };
+
+    // Bands whose excitation is this far (-90 dB) below the strongest band are reported as unmeasured
+    constexpr float minRelativeExcitation = 1.0e-9f;
+}
+
+void TransferFunctionMeter::prepare(double newSampleRate, int newFftSize, const Filterbank& newBands)
+{
+    sampleRate = newSampleRate;
+    fftSize = newFftSize;
+    numBins = fftSize / 2 + 1;
+    bands = &newBands;
+
+    for (auto* block : { &crossReal, &crossImag, &inputPower, &outputPower,
+                         &crossMagnitude, &crossPower, &autoProduct, &delayReal, &delayImag })
+        block->allocate((size_t)numBins, true);
+
+    auto numBands = (size_t)bands->getNumBands();
+    bandScratch.assign(numBands * numBandSums, 0.0f);
+    bandGain.assign(numBands, 0.0f);
+    bandPhase.assign(numBands, 0.0f);
+    bandGroupDelay.assign(numBands, 0.0f);
+    bandCoherence.assign(numBands, 0.0f);
+
+    reset();
+}
+
+void TransferFunctionMeter::reset() noexcept
+{
+    for (auto* block : { &crossReal, &crossImag, &inputPower, &outputPower })
+        juce::FloatVectorOperations::clear(block->get(), numBins);
+
+    std::fill(bandGain.begin(), bandGain.end(), 0.0f);
+    std::fill(bandPhase.begin(), bandPhase.end(), 0.0f);
+    std::fill(bandGroupDelay.begin(), bandGroupDelay.end(), 0.0f);
+    std::fill(bandCoherence.begin(), bandCoherence.end(), 0.0f);
+    numAveraged = 0;
+}
+
+void TransferFunctionMeter::process(const float* xReal, const float* xImag, const float* yReal, const float* yImag) noexcept
+{
+    // Running mean over the first frames, then an exponential average with the same time constant
+    numAveraged = juce::jmin(numAveraged + 1, (int)averagingFrames);
+    auto weight = 1.0f / (float)numAveraged;
+
+    auto* gr = crossReal.get();
+    auto* gi = crossImag.get();
+    auto* gxx = inputPower.get();
+    auto* gyy = outputPower.get();
+
+    // X* Y = (xr - i xi)(yr + i yi)
+    for (int k = 0; k < numBins; ++k)
+    {
+        auto xr = xReal[k], xi = xImag[k], yr = yReal[k], yi = yImag[k];
+        gr[k] += (xr * yr + xi * yi - gr[k]) * weight;
+        gi[k] += (xr * yi - xi * yr - gi[k]) * weight;
+        gxx[k] += (xr * xr + xi * xi - gxx[k]) * weight;
+        gyy[k] += (yr * yr + yi * yi - gyy[k]) * weight;
+    }
+
+    updateBands();
+}
+
+void TransferFunctionMeter::updateBands() noexcept
+{
+    auto* gr = crossReal.get();
+    auto* gi = crossImag.get();
+
+    for (int k = 0; k < numBins; ++k)
+    {
+        crossPower[k] = gr[k] * gr[k] + gi[k] * gi[k];
+        crossMagnitude[k] = std::sqrt(crossPower[k]);
+        autoProduct[k] = inputPower[k] * outputPower[k];
+    }
+
+    // Gxy[k + 1] conj(Gxy[k - 1]), zero at the two edge bins
+    delayReal[0] = delayImag[0] = delayReal[numBins - 1] = delayImag[numBins - 1] = 0.0f;
+    for (int k = 1; k < numBins - 1; ++k)
+    {
+        delayReal[k] = gr[k + 1] * gr[k - 1] + gi[k + 1] * gi[k - 1];
+        delayImag[k] = gi[k + 1] * gr[k - 1] - gr[k + 1] * gi[k - 1];
+    }
+
+    auto numBands = bands->getNumBands();
+    auto sums = [this, numBands](int which) { return bandScratch.data() + which * numBands; };
+
+    bands->apply(crossMagnitude.get(), sums(sumCrossMagnitude));
+    bands->apply(inputPower.get(), sums(sumInputPower));
+    bands->apply(crossPower.get(), sums(sumCrossPower));
+    bands->apply(autoProduct.get(), sums(sumAutoProduct));
+    bands->apply(crossReal.get(), sums(sumCrossReal));
+    bands->apply(crossImag.get(), sums(sumCrossImag));
+    bands->apply(delayReal.get(), sums(sumDelayReal));
+    bands->apply(delayImag.get(), sums(sumDelayImag));
+
+    auto* excitation = sums(sumInputPower);
+    auto threshold = *std::max_element(excitation, excitation + numBands) * minRelativeExcitation;
+    auto delayScale = -1.0 / (2.0 * juce::MathConstants<double>::twoPi * (sampleRate / fftSize));
+
+    for (int b = 0; b < numBands; ++b)
+    {
+        auto index = (size_t)b;
+        if (excitation[b] <= threshold || excitation[b] <= 0.0f)
+        {
+            bandGain[index] = bandPhase[index] = bandGroupDelay[index] = bandCoherence[index] = 0.0f;
+            continue;
+        }
+
+        // Excitation weighted mean of |H1|: each bin's |Gxy| / Gxx weighted by its Gxx
+        bandGain[index] = FastMath::gainToDecibels(juce::jmax(1.0e-10f, sums(sumCrossMagnitude)[b] / excitation[b]));
+        bandPhase[index] = std::atan2(sums(sumCrossImag)[b], sums(sumCrossReal)[b]);
+        bandGroupDelay[index] = (float)(delayScale * std::atan2(sums(sumDelayImag)[b], sums(sumDelayReal)[b]));
+
+        auto product = sums(sumAutoProduct)[b];
+        bandCoherence[index] = product > 0.0f ? juce::jlimit(0.0f, 1.0f, sums(sumCrossPower)[b] / product) : 0.0f;
+    }
+}
+
+float TransferFunctionMeter::getGain(int bin) const noexcept
+{
+    if (!juce::isPositiveAndBelow(bin, numBins) || inputPower[bin] <= 0.0f)
+        return 0.0f;
+
+    auto magnitude = std::sqrt(crossReal[bin] * crossReal[bin] + crossImag[bin] * crossImag[bin]);
+    return FastMath::gainToDecibels(juce::jmax(1.0e-10f, magnitude / inputPower[bin]));
+}
+
+float TransferFunctionMeter::getPhase(int bin) const noexcept
+{
+    return juce::isPositiveAndBelow(bin, numBins) ? std::atan2(crossImag[bin], crossReal[bin]) : 0.0f;
+}
+
+float TransferFunctionMeter::getGroupDelay(int bin) const noexcept
+{
+    if (bin < 1 || bin >= numBins - 1)
+        return 0.0f;
+
+    auto re = delayReal[bin], im = delayImag[bin];
+    return (float)(-std::atan2(im, re) / (2.0 * juce::MathConstants<double>::twoPi * (sampleRate / fftSize)));
+}
+
+float TransferFunctionMeter::getCoherence(int bin) const noexcept
+{
+    if (!juce::isPositiveAndBelow(bin, numBins) || autoProduct[bin] <= 0.0f)
+        return 0.0f;
+
+    return juce::jlimit(0.0f, 1.0f, crossPower[bin] / autoProduct[bin]);
+}
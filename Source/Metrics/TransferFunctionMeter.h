@@ -0,0 +1,70 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Filterbank.h"
+
+// ===============================================================================================================
+// Frequency response of the hosted plugins, measured against the stimulus that went into them.
+//
+// Welch's method: every STFT frame adds X* Y, |X|^2 and |Y|^2 of the input (x) and output (y) spectra to
+// running averages of the cross- and auto-spectra Gxy, Gxx and Gyy, updated in place like DistortionMeter's
+// powers. From those, per bin:
+//   H1 = Gxy / Gxx                         gain and phase, unbiased by noise added at the output
+//   coherence = |Gxy|^2 / (Gxx Gyy)        1 for a linear, noise-free path, lower where H1 can't be trusted
+//   group delay = -d(arg H) / d(omega)     central difference, taken as the argument of Gxy[k+1] conj(Gxy[k-1])
+//                                          so the phase never needs unwrapping
+// The input must be broadband (noise, sweep or multitone) and sample aligned with the output, i.e. delayed
+// by the chain latency. Band values use a Filterbank, weighting each bin by how strongly it was excited.
+class TransferFunctionMeter
+{
+public:
+    enum
+    {
+        averagingFrames = 32    // ~700 ms at 48 kHz with the default hop
+    };
+
+    TransferFunctionMeter() = default;
+
+    // Allocates, call while the analysis thread is stopped. bands must outlive the meter's use.
+    void prepare(double newSampleRate, int newFftSize, const Filterbank& newBands);
+    void reset() noexcept;
+
+    // Analysis thread: planar spectra, fftSize / 2 + 1 bins each, of the input (x) and output (y)
+    void process(const float* xReal, const float* xImag, const float* yReal, const float* yImag) noexcept;
+
+    bool hasReading() const noexcept { return numAveraged > 0; }
+    int getNumBins() const noexcept { return numBins; }
+    int getNumBands() const noexcept { return bands != nullptr ? bands->getNumBands() : 0; }
+
+    // Per bin
+    float getGain(int bin) const noexcept;           // dB
+    float getPhase(int bin) const noexcept;          // radians, -pi .. pi
+    float getGroupDelay(int bin) const noexcept;     // seconds
+    float getCoherence(int bin) const noexcept;      // 0 .. 1
+
+    // Per band, updated by process()
+    float getBandGain(int band) const noexcept { return bandGain[(size_t)band]; }
+    float getBandPhase(int band) const noexcept { return bandPhase[(size_t)band]; }
+    float getBandGroupDelay(int band) const noexcept { return bandGroupDelay[(size_t)band]; }
+    float getBandCoherence(int band) const noexcept { return bandCoherence[(size_t)band]; }
+
+private:
+    void updateBands() noexcept;
+
+    double sampleRate = 44100.0;
+    int fftSize = 0;
+    int numBins = 0;
+    const Filterbank* bands = nullptr;
+
+    // Welch averages
+    juce::HeapBlock<float> crossReal, crossImag, inputPower, outputPower;
+    int numAveraged = 0;
+
+    // Per bin inputs to the band sums
+    juce::HeapBlock<float> crossMagnitude, crossPower, autoProduct, delayReal, delayImag;
+    std::vector<float> bandScratch;
+
+    std::vector<float> bandGain, bandPhase, bandGroupDelay, bandCoherence;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(TransferFunctionMeter)
+};
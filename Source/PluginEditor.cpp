@@ -18,11 +18,41 @@ ChainBuilderAudioProcessorEditor::ChainBuilderAudioProcessorEditor (ChainBuilder
     initWindowSize_Editor();
     dropZone = new PluginDropZone(audioProcessor, *this);
 
+    // Test signal sent through the hosted plugin
+    stimulusSelector.addItemList(StimulusGenerator::getTypeNames(), 1);
+    stimulusSelector.setSelectedId((int)audioProcessor.stimulus.getType() + 1, juce::dontSendNotification);
+    stimulusSelector.onChange = [this]
+    {
+        audioProcessor.stimulus.setType((StimulusGenerator::Type)(stimulusSelector.getSelectedId() - 1));
+        audioProcessor.analysisThread.resetLoudness(); // integrated loudness of the new programme only
+        audioProcessor.updateChainLatency();           // the rack only adds latency while a stimulus runs
+    };
+    addAndMakeVisible(stimulusSelector);
+
+    // Analysis resolution: small sizes react faster, large ones resolve low frequencies
+    for (int order = FftPlan::minOrder; order <= FftPlan::maxOrder; ++order)
+        fftSizeSelector.addItem(juce::String(1 << order), order);
+    fftSizeSelector.setSelectedId(audioProcessor.analysisThread.getFftOrder(), juce::dontSendNotification);
+    fftSizeSelector.onChange = [this] { audioProcessor.analysisThread.setFftOrder(fftSizeSelector.getSelectedId()); };
+    addAndMakeVisible(fftSizeSelector);
+
+    windowSelector.addItemList(FftPlan::getWindowNames(), 1);
+    windowSelector.setSelectedId((int)audioProcessor.analysisThread.getWindow() + 1, juce::dontSendNotification);
+    windowSelector.onChange = [this]
+    {
+        audioProcessor.analysisThread.setWindow((FftPlan::Window)(windowSelector.getSelectedId() - 1));
+    };
+    addAndMakeVisible(windowSelector);
+
+    // Only what's on screen gets computed while the editor is open
+    audioProcessor.analysisThread.subscribe(MetricConsumer::display, getDisplayMetrics());
 
 }
 
 ChainBuilderAudioProcessorEditor::~ChainBuilderAudioProcessorEditor()
 {
+    audioProcessor.analysisThread.subscribe(MetricConsumer::display, {});
+    audioProcessor.analysisThread.subscribe(MetricConsumer::prompt, {});
 }
 
 //==============================================================================
@@ -63,6 +93,9 @@ void ChainBuilderAudioProcessorEditor::togglePromptSidebar(bool shouldShow)
 
     sidebarVisible = shouldShow;
 
+    // The payload's metrics only run while a prompt can be sent, they settle while it is being typed
+    audioProcessor.analysisThread.subscribe(MetricConsumer::prompt, sidebarVisible ? getPromptMetrics() : MetricSet());
+
     int currentWidth = getWidth();
     int targetWidth = sidebarVisible ? currentWidth + sidebarWidth : currentWidth - sidebarWidth;
 
@@ -85,6 +118,14 @@ void ChainBuilderAudioProcessorEditor::resized()
 
     auto area = getLocalBounds(); // full plugin area
 
+    // Stimulus selector sits in the strip under the drop zone
+    stimulusSelector.setBounds(10, getHeight() - 60, (int)(getWidth() * 0.2f) - 20, 24);
+
+    // FFT size and window share the row below it
+    auto analysisWidth = ((int)(getWidth() * 0.2f) - 25) / 2;
+    fftSizeSelector.setBounds(10, getHeight() - 32, analysisWidth, 24);
+    windowSelector.setBounds(15 + analysisWidth, getHeight() - 32, analysisWidth, 24);
+
     // ================== Display Slidebar =======================
     if (sidebarVisible)
     {
@@ -34,6 +34,7 @@ public:
     // Display Functions
     void initWindowSize_Editor();
     void display_metrics();
+    static MetricSet getDisplayMetrics();   // what display_metrics() reads
     void showText();
     juce::Label Translate;
     juce::Label Discuss;
@@ -47,6 +48,7 @@ public:
 
     // LLM API Functions
     std::string prompt_gen();
+    static MetricSet getPromptMetrics();    // what prompt_gen() sends
     void api_func();
 
     // License Functions
@@ -83,9 +85,16 @@ public:
     uint32_t color_4 = 0xfff2f6d0;
     juce::String fontName = "Arial";
 
+    // Stimulus
+    juce::ComboBox stimulusSelector;
+
+    // Analysis settings
+    juce::ComboBox fftSizeSelector, windowSelector;
+
     // Display
     void display_params(juce::Rectangle<int> boundsToUse);
     void testParameterDisplayOffsets();
+    void clearParameterDisplays();
     int hostedPlugin_height;
     int hostedPlugin_width;
     juce::Array<juce::AudioProcessorParameter*> chosen_parameters; // Parameters chosen by LLM
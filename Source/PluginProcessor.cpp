@@ -20,15 +20,14 @@ ChainBuilderAudioProcessor::ChainBuilderAudioProcessor()
                       #endif
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                      #endif
-                       ),
-forwardFFT(fftOrder),
-window(fftSize, juce::dsp::WindowingFunction<float>::hann)
+                       )
 #endif
 {
 }
 
 ChainBuilderAudioProcessor::~ChainBuilderAudioProcessor()
 {
+    analysisThread.stopThread(1000);
 }
 
 //==============================================================================
@@ -98,12 +97,28 @@ void ChainBuilderAudioProcessor::prepareToPlay (double sampleRate, int samplesPe
 {
     // Use this method as the place to do any pre-playback
     // initialisation that you need..
+    analysisThread.stopThread(1000);
+
+    // Hold at least half a second of audio so the analysis thread can fall behind a little without drops
+    auto numChannels = juce::jmax(getTotalNumInputChannels(), getTotalNumOutputChannels());
+    // The stimulus rides along as reference channels for the transfer function
+    analysisFifo.prepare(numChannels, juce::jmax(4 << FftPlan::maxOrder, (int)(sampleRate * 0.5), 4 * samplesPerBlock), numChannels);
+    analysisThread.prepare(sampleRate, numChannels);
+    referenceBuffer.setSize(numChannels, samplesPerBlock);
+
+    rack.prepare(sampleRate, samplesPerBlock, numChannels);
+    updateChainLatency();
+    stimulus.prepare(sampleRate, numChannels);
+
+    analysisThread.startThread(juce::Thread::Priority::low);
 }
 
 void ChainBuilderAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    analysisThread.stopThread(1000);
+    rack.releaseResources();
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -138,118 +153,90 @@ void ChainBuilderAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer,
     auto totalNumInputChannels = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
-    // Set buffer to have correct number of channels
-    if (hostedPlugin != nullptr)
-    {
-        //DBG("============== Hosted Plugin Information");
-        //DBG("Plugin Input Channels: " << hostedPlugin->getTotalNumInputChannels());
-        //DBG("Plugin Output Channels: " << hostedPlugin->getTotalNumOutputChannels());
-        //DBG("Buffer Channels: " << buffer.getNumChannels());
-
-        buffer.setSize(hostedPlugin->getTotalNumInputChannels(), buffer.getNumSamples(), true, true, true);
-    }
-
     // Clear any output channels that don't contain input data
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear(i, 0, buffer.getNumSamples());
 
-    bool useWhiteNoiseForFifo = true;
-    // ======================= White Noise Test ==========================
-    if (useWhiteNoiseForFifo)
+    // ======================= Stimulus Test ==========================
+    if (stimulus.isActive())
     {
-        if (buffer.getNumChannels() > 0)
-        {
-            for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
-            {
-                auto* writePointer = buffer.getWritePointer(channel);
-                for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
-                {
-                    float noise = juce::Random::getSystemRandom().nextFloat() * 2.0f - 1.0f;
-                    writePointer[sample] = noise;
-                }
-            }
-        }
-
-        // 2. Pass through hosted EQ
-        if (hostedPlugin != nullptr)
-        {
-            hostedPlugin->processBlock(buffer, midiMessages);
-        }
-
-        // 3. Analyze *post-EQ* signal (first channel is fine for FFT)
-        if (buffer.getNumChannels() > 0)
-        {
-            for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
-            {
-                auto* channelData = buffer.getReadPointer(ch);
-                float chSum = 0.0f;
-
-                for (int i = 0; i < buffer.getNumSamples(); ++i)
-                {
-                    chSum += std::abs(channelData[i]);
-
-                    if (ch == 0)
-                        pushNextSampleIntoFifo(channelData[i], buffer);
-                }
-
-                // DBG("Post-plugin buffer energy: channel " << ch << " = " << chSum);
-            }
-        }
+        auto numSamples = buffer.getNumSamples();
+
+        // 1. Replace the input with the selected test signal
+        stimulus.render(buffer);
 
+        // 2. Keep what went in, the analysis thread measures the chain against it
+        auto hasReference = referenceDelay != nullptr && numSamples <= referenceBuffer.getNumSamples();
+        if (hasReference)
+            for (int ch = 0; ch < juce::jmin(buffer.getNumChannels(), referenceBuffer.getNumChannels()); ++ch)
+                referenceBuffer.copyFrom(ch, 0, buffer, ch, 0, numSamples);
 
+        // 3. Pass through the hosted branches
+        rack.process(buffer, midiMessages);
 
+        // 4. Hand the *post-chain* signal to the analysis thread, with the stimulus lined up against it
+        if (hasReference)
+            referenceDelay->process(referenceBuffer, numSamples);
+
+        analysisFifo.push(buffer, numSamples, hasReference ? &referenceBuffer : nullptr);
     }
     // Live From DAW
-    else if (buffer.getNumChannels() > 0)
+    else
     {
-        auto* channelData = buffer.getReadPointer(0); // pointer to first channel
-        for (int i = 0; i < buffer.getNumSamples(); ++i)
-        {
-            pushNextSampleIntoFifo(channelData[i], buffer);
-        }
+        analysisFifo.push(buffer, buffer.getNumSamples());
     }
+}
 
+juce::Result ChainBuilderAudioProcessor::addPluginToChain(std::unique_ptr<juce::AudioPluginInstance> plugin, int branchIndex,
+                                                          int nodeIndex, bool isPrepared)
+{
+    JUCE_ASSERT_MESSAGE_THREAD
 
+    // Asking for the branch after the last one starts a new parallel branch
+    if (branchIndex >= rack.size())
+        branchIndex = rack.addBranch();
 
-}
+    auto* chain = rack.getChain(branchIndex);
+    if (chain == nullptr)
+        return juce::Result::fail("No room for another branch");
 
-void ChainBuilderAudioProcessor::pushNextSampleIntoFifo(float sample, juce::AudioBuffer<float>& buffer) noexcept
-{
-    // if the fifo contains enough data, set a flag to say that the next frame should now be rendered..
-    if (fifoIndex == fftSize)
+    if (juce::isPositiveAndBelow(nodeIndex, chain->size()))
+    {
+        if (!chain->replacePlugin(nodeIndex, std::move(plugin), isPrepared))
+            return juce::Result::fail("The plugin to replace was removed");
+    }
+    else if (!chain->appendPlugin(std::move(plugin), isPrepared))
     {
-        juce::zeromem(fftData, sizeof(fftData));    // clear fftData buffer
-        memcpy(fftData, fifo, sizeof(fifo));        // copy FIFO into fftData
-
-        // Time Based Functions
-        rms = Metrics::computeRMS(buffer);
-        lufs = Metrics::computeLUFS(buffer, getSampleRate());
-        peak = Metrics::computePeakLevel(buffer);
-        crest_factor = Metrics::computeCrestFactor(buffer);
-        transient_sharpness = Metrics::computeTransientSharpness(buffer, getSampleRate());
-        decay_time = Metrics::computeDecayTime(buffer, getSampleRate());
-        stereo_correlation = Metrics::computeStereoCorrelation(buffer);
-
-        // Frequency Based Functions
-        window.multiplyWithWindowingTable(fftData, fftSize);        // Window the signal first
-        forwardFFT.performRealOnlyForwardTransform(fftData, fftData);   // Perform forward FFT including phase
-
-        spectral_centroid = Metrics::computeSpectralCentroid(fftData, getSampleRate());
-        spectral_rolloff = Metrics::computeSpectralRolloff(fftData, getSampleRate(), 0.95f);
-        spectral_flatness = Metrics::computeSpectralFlatness(fftData);
-        resonance_score = Metrics::computeResonanceScore(fftData, getSampleRate());
-        harmonic_to_noise = Metrics::computeHarmonicToNoiseRatio(fftData, getSampleRate());
-
-        //DBG("Spectral Centroid: " << juce::String(spectral_centroid)
-        //<< " Spectral Rollof: " << juce::String(spectral_rolloff)
-        //<< " Spectral Flatness: " << juce::String(spectral_flatness)
-        //<< " Resonance Score: " << juce::String(resonance_score)
-        //<< " Harmonic to Noise Ratio: " << juce::String(harmonic_to_noise));
-        fifoIndex = 0;                              // reset FIFO index
+        return juce::Result::fail("No room for another plugin in this branch");
     }
 
-    fifo[fifoIndex++] = sample;
+    // Compensate for the new plugin right away rather than on some later update
+    updateChainLatency();
+    return juce::Result::ok();
+}
 
+void ChainBuilderAudioProcessor::updateChainLatency()
+{
+    // Branches are aligned to the slowest one. Live mode only analyses the DAW's signal and never runs the
+    // rack, so it adds no latency and the DAW must not compensate for any.
+    rack.updateLatencyCompensation();
+    setLatencySamples(stimulus.isActive() ? rack.getTotalLatency() : 0);
+
+    // The analysis reference is delayed as much as the rack's output, same handover as the branch compensation.
+    // prepareToPlay may also have changed its channel count.
+    auto latency = rack.getTotalLatency();
+    auto numChannels = juce::jmax(1, referenceBuffer.getNumChannels());
+    if (referenceDelay == nullptr || referenceDelay->getDelay() != latency || referenceDelay->getNumChannels() != numChannels)
+    {
+        auto oldLatency = referenceDelay != nullptr ? referenceDelay->getDelay() : 0;
+        auto newDelay = std::make_unique<LatencyDelay>();
+        newDelay->setDelay(numChannels, latency, oldLatency);
+
+        const juce::ScopedLock sl(getCallbackLock());
+        if (referenceDelay != nullptr)
+            newDelay->continueFrom(*referenceDelay, juce::roundToInt(getSampleRate() * PluginChain::crossfadeMs * 0.001));
+        std::swap(referenceDelay, newDelay);
+    }
 }
 
 //==============================================================================
@@ -10,6 +10,11 @@
 
 #include <JuceHeader.h>
 #include "Metrics/Metrics.h"
+#include "Analysis/AnalysisFifo.h"
+#include "Analysis/AnalysisThread.h"
+#include "Engine/BranchRack.h"
+#include "Engine/PluginLoader.h"
+#include "Engine/StimulusGenerator.h"
 
 
 //==============================================================================
@@ -55,37 +60,28 @@ public:
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
-    std::unique_ptr<juce::AudioPluginInstance> hostedPlugin = nullptr;
+    // Hosted plugins: parallel branches, each one a serial chain. Branch 0 is the main chain.
+    BranchRack rack{ getCallbackLock() };
+    // Instantiates and prepares plugins in the background, see PluginLoader::loadPlugin
+    PluginLoader pluginLoader{ *this };
+    // Message thread, like every other change to the rack. nodeIndex >= 0 hot-swaps that node of the branch
+    // instead of appending, isPrepared skips prepareToPlay if it was already called at the current settings.
+    // Fails and destroys the plugin if the rack or the branch is full.
+    juce::Result addPluginToChain(std::unique_ptr<juce::AudioPluginInstance> plugin, int branchIndex = 0,
+                                  int nodeIndex = -1, bool isPrepared = false);
+    // Message thread. Call after the chain or the stimulus type changed.
+    void updateChainLatency();
+
     bool pluginPrepared = false;
+    StimulusGenerator stimulus;    // test signal fed to the hosted plugin, Type::live analyses the DAW input
+
+    // Analysis: processBlock only copies blocks into the fifo, the analysis thread does the rest
+    AnalysisFifo analysisFifo;
+    AnalysisThread analysisThread{ *this, analysisFifo };
+    // The stimulus as it entered the rack, delayed by the chain latency so it lines up with the output
+    juce::AudioBuffer<float> referenceBuffer;
+    std::unique_ptr<LatencyDelay> referenceDelay;
 
-    enum
-    {
-        fftOrder = 12,              // this designates the size of the fft 2 ^ fft_Order
-        fftSize = 1 << fftOrder,    // calculating the fftSize
-        scopeSize = 2048             // number of points in the visual representation
-    };
-
-    float fifo[fftSize]; // contains our incoming audio data in samples
-    float fftData[2 * fftSize]; // will contain the results of our fft
-    int fifoIndex = 0;
-    juce::dsp::FFT forwardFFT; // instantiating (FFT) class to perform the forward FFT on
-    juce::dsp::WindowingFunction<float> window; // instantiating (window) class to apply windowing function on
-    void pushNextSampleIntoFifo(float sample, juce::AudioBuffer<float>& buffer) noexcept;
-    
-    /* Metric Variables */
-    float spectral_centroid = 0.f;
-    float spectral_rolloff = 0.f;
-    float spectral_flatness = 0.f;
-    float resonance_score = 0.f;
-    float harmonic_to_noise = 0.f;
-    float rms = 0.f;
-    float lufs = 0.f;
-    float peak = 0.f;
-    float crest_factor = 0.f;
-    float transient_sharpness = 0.f;
-    float decay_time = 0.f;
-    float stereo_correlation = 0.f;
-    float modulation_depth = 0.f;
 private:
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ChainBuilderAudioProcessor)